@@ -19,6 +19,14 @@
 
 // (You can add your own code in this section, and the Introjucer will not overwrite it)
 
+// Channel layouts for the multichannel engine (up to kMaxChannels = 16) and the sidechain
+// input ({4, 2} is stereo plus a stereo key). The generated settings below only apply if
+// these aren't defined, so they are kept here, where saving the project won't revert them -
+// the project's plugin settings should carry the same values.
+#define JucePlugin_MaxNumInputChannels              16
+#define JucePlugin_MaxNumOutputChannels             16
+#define JucePlugin_PreferredChannelConfigurations   {2, 2}, {4, 2}, {1, 1}, {6, 6}, {8, 8}, {12, 12}, {16, 16}
+
 // [END_USER_CODE_SECTION]
 
 //==============================================================================
@@ -38,7 +38,7 @@ struct Control
 };
 
 const Bounds AUTO_SIZE = Bounds(-1,-1,-1,-1); // used to trigger automatic layout
-enum { kParam0, kParam1, kParam2, kParam3, kParam4, kParam5, kParam6, kParam7, kParam8, kParam9, kParam10, kParam11, kParam12, kParam13, kParam14, kParam15, kParam16, kParam17};
+enum { kParam0, kParam1, kParam2, kParam3, kParam4, kParam5, kParam6, kParam7, kParam8, kParam9, kParam10, kParam11, kParam12, kParam13, kParam14, kParam15, kParam16, kParam17, kParam18, kParam19, kParam20, kParam21, kParam22, kParam23, kParam24, kParam25, kParam26, kParam27, kParam28, kParam29, kParam30, kParam31, kParam32, kParam33, kParam34, kParam35, kParam36, kParam37, kParam38, kParam39, kParam40, kParam41, kParam42};
 
 //==========================================================================
 // UI_CONTROLS - Use this array to completely specify your UI
@@ -69,6 +69,33 @@ const Control UI_CONTROLS[] = {
     {   "Mono",  kParam13,    TOGGLE, 0.0, 1.0, 0.0,    Bounds (230,55,55,20)   },
     {   "Knee",  kParam14,    ROTARY, 1.0, 3.0, 1.0,    Bounds (85,190,50,45)   },
     {   "Lookahead (0-200ms)",  kParam15,    ROTARY, 0.0, 0.2, 0.0,    Bounds (20,190,50,45)   },
+    {   "True Peak",  kParam16,    MENU, 0.0, 2.0, 0.0,    Bounds (15,275,60,20), "Off", "4x", "8x"   },
+    {   "Gain Oversampling",  kParam17,    MENU, 0.0, 2.0, 0.0,    Bounds (80,275,60,20), "Off", "2x", "4x"   },
+    {   "OS Quality",  kParam18,    MENU, 0.0, 2.0, 0.0,    Bounds (145,275,60,20), "Auto", "Realtime", "Offline"   },
+    {   "Ext Sidechain",  kParam19,    TOGGLE, 0.0, 1.0, 0.0,    Bounds (210,275,60,20)   },
+    {   "Key HPF (Hz)",  kParam20,    ROTARY, 0.0, 1000.0, 0.0,    Bounds (20,330,50,45)   },
+    {   "Stereo Link",  kParam21,    MENU, 0.0, 3.0, 0.0,    Bounds (275,275,60,20), "Unlinked", "Max", "Sum", "Partial"   },
+    {   "Link Amount",  kParam22,    ROTARY, 0.0, 1.0, 0.5,    Bounds (85,330,50,45)   },
+    {   "Stereo Mode",  kParam23,    MENU, 0.0, 1.0, 0.0,    Bounds (340,275,60,20), "L/R", "Mid/Side"   },
+    {   "Link Groups",  kParam24,    MENU, 0.0, 1.0, 0.0,    Bounds (150,340,60,20), "All", "Pairs"   },
+    {   "Gain Curve",  kParam25,    MENU, 0.0, 2.0, 0.0,    Bounds (215,340,60,20), "Exact", "Table", "Custom"   },
+    {   "Envelope",  kParam26,    MENU, 0.0, 1.0, 0.0,    Bounds (280,340,60,20), "Branching", "Decoupled"   },
+    {   "Auto Release",  kParam27,    TOGGLE, 0.0, 1.0, 0.0,    Bounds (345,340,60,20)   },
+    {   "Detector",  kParam28,    MENU, 0.0, 2.0, 0.0,    Bounds (15,400,60,20), "Feed-fwd", "Feedback", "Hybrid"   },
+    {   "High Mode",  kParam29,    MENU, 0.0, 3.0, 0.0,    Bounds (80,400,60,20), "Compress", "Upward", "Expand", "Gate"   },
+    {   "Low Mode",  kParam30,    MENU, 0.0, 3.0, 0.0,    Bounds (145,400,60,20), "Compress", "Upward", "Expand", "Gate"   },
+    {   "High Range (dB)",  kParam31,    ROTARY, 0.0, 80.0, 80.0,    Bounds (20,450,50,45)   },
+    {   "Low Range (dB)",  kParam32,    ROTARY, 0.0, 80.0, 80.0,    Bounds (85,450,50,45)   },
+    {   "High Hysteresis (dB)",  kParam33,    ROTARY, 0.0, 12.0, 0.0,    Bounds (155,450,50,45)   },
+    {   "Low Hysteresis (dB)",  kParam34,    ROTARY, 0.0, 12.0, 0.0,    Bounds (220,450,50,45)   },
+    {   "Limiter",  kParam35,    TOGGLE, 0.0, 1.0, 0.0,    Bounds (210,400,60,20)   },
+    {   "Ceiling (dB)",  kParam36,    ROTARY, -12.0, 0.0, -1.0,    Bounds (285,450,50,45)   },
+    {   "Auto Makeup",  kParam37,    TOGGLE, 0.0, 1.0, 0.0,    Bounds (280,400,60,20)   },
+    {   "Momentary (LUFS)",  kParam38,    METER, -70.0, 0.0, -70.0,    Bounds (20,525,100,10)   },
+    {   "Short-term (LUFS)",  kParam39,    METER, -70.0, 0.0, -70.0,    Bounds (135,525,100,10)   },
+    {   "Integrated (LUFS)",  kParam40,    METER, -70.0, 0.0, -70.0,    Bounds (250,525,100,10)   },
+    {   "Filter Precision",  kParam41,    MENU, 0.0, 1.0, 0.0,    Bounds (345,400,60,20), "Double", "Float"   },
+    {   "Custom Curve",  kParam42,    MENU, 0.0, 5.0, 0.0,    Bounds (345,450,60,20), "User", "Gentle", "Glue", "Vocal", "Limit", "Expand"   },
     
 };
 
@@ -92,9 +119,9 @@ struct Preset
 // - for LEVEL, the value is read-only; simply insert 0
 
 const Preset UI_PRESETS[] = {
-    { "Bright Guitar", 0.45650, 3.81250, 1.62853, 0, 0, 0, 0, 0.59224, 1.65502, 1.12500, 0.03670, 0.09975, 3956.61792, 0, 2.08256, 0},
-    { "Drums Sparkle", 0.39912, 16.00000, 2.02754, 0, 0, 0, 0, 0.11612, 16.00000, 1.90708, 0.04648, 0.09996, 2411.25439, 1.00000, 0.00000},
-    { "Add Body", 0.41250, 9.40386, 1.12500, 0, 0, 0, 0, 0.41945, 10.54632, 2.87853, 0.01321, 0.09992, 1022.75934, 3.00000, 0.00320},
+    { "Bright Guitar", 0.45650, 3.81250, 1.62853, 0, 0, 0, 0, 0.59224, 1.65502, 1.12500, 0.03670, 0.09975, 3956.61792, 0, 2.08256, 0, 0, 0, 0, 0, 0, 0, 0.5, 0, 0, 0, 0, 0, 0, 0, 0, 80, 80, 0, 0, 0, -1, 0, 0, 0, 0, 0, 0},
+    { "Drums Sparkle", 0.39912, 16.00000, 2.02754, 0, 0, 0, 0, 0.11612, 16.00000, 1.90708, 0.04648, 0.09996, 2411.25439, 1.00000, 0.00000, 0, 0, 0, 0, 0, 0, 0, 0.5, 0, 0, 0, 0, 0, 0, 0, 0, 80, 80, 0, 0, 0, -1, 0, 0, 0, 0, 0, 0},
+    { "Add Body", 0.41250, 9.40386, 1.12500, 0, 0, 0, 0, 0.41945, 10.54632, 2.87853, 0.01321, 0.09992, 1022.75934, 3.00000, 0.00320, 0, 0, 0, 0, 0, 0, 0, 0.5, 0, 0, 0, 0, 0, 0, 0, 0, 80, 80, 0, 0, 0, -1, 0, 0, 0, 0, 0, 0},
 };
 
 #endif
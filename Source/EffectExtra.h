@@ -7,6 +7,152 @@
 
 #include "PluginWrapper.h"
 
+#if JUCE_INTEL
+ #include <emmintrin.h>
+ #define EFFECT_USE_SSE 1
+#else
+ #define EFFECT_USE_SSE 0
+#endif
+
+// Output level (dB) of a user TransferCurve for an input level (dB) - the breakpoints
+// must be in order with knees no wider than the gaps to their neighbours (see MyEffect::setTransferCurve)
+inline float transferCurve(const TransferCurve& curve, float x)
+{
+    float fSlopeBelow = 1.0;                                                                        //1:1 below the first breakpoint
+    
+    for (int k = 0; k < curve.iNumPoints; k++){
+        float fSlopeAbove = fSlopeBelow;                                                            //the last segment carries on
+        if (k + 1 < curve.iNumPoints){
+            fSlopeAbove = (curve.fOutput[k + 1] - curve.fOutput[k]) / (curve.fInput[k + 1] - curve.fInput[k]);
+        }
+        
+        float fHalfKnee = 0.5 * curve.fKnee[k];
+        float d = x - curve.fInput[k];
+        if (d < -fHalfKnee){
+            return curve.fOutput[k] + fSlopeBelow * d;                                              //straight segment below this breakpoint
+        }
+        if (d <= fHalfKnee && fHalfKnee > 0.0){
+            float q = d + fHalfKnee;
+            return curve.fOutput[k] + fSlopeBelow * d + (fSlopeAbove - fSlopeBelow) * q * q / (4.0 * fHalfKnee);   //same second order knee as GainComputer
+        }
+        fSlopeBelow = fSlopeAbove;
+    }
+    
+    if (curve.iNumPoints == 0){
+        return x;
+    }
+    int iLast = curve.iNumPoints - 1;
+    return curve.fOutput[iLast] + fSlopeBelow * (x - curve.fInput[iLast]);
+}
+
+//==========================================================================
+// GainComputer - the static curve for every gain mode, as one set of coefficients (dB):
+// a slope below the threshold, a slope above it, a second order knee joining
+// them, and a range the gain is held within.
+//   GAIN_COMPRESS - level above the threshold pushed down by the ratio, cut by at most the range
+//   GAIN_UPWARD   - level below the threshold brought up by the ratio, lifted by at most the range
+//   GAIN_EXPAND   - level below the threshold pushed down by the ratio, cut by at most the range
+//   GAIN_GATE     - as expand, with a ratio steep enough to shut
+// Once a lane has gone over the threshold, hysteresis lowers it for that lane, so a gate
+// opens at the threshold but doesn't close again until the level drops that much below.
+// Only the coefficients differ between modes - process() runs four lanes at a time
+// without branches whichever is set.
+
+enum GAIN_MODE { GAIN_COMPRESS, GAIN_UPWARD, GAIN_EXPAND, GAIN_GATE };
+
+struct GainComputer
+{
+    enum { kGateRatio = 100 };
+    
+    void set(int iMode, float thresh, float ratio, float kneeWidth, float rangeDb, float hysteresisDb)
+    {
+        fThresh = thresh;
+        fKnee = kneeWidth;
+        fSlopeBelow = fSlopeAbove = 0.0f;
+        fMinGain = -rangeDb;
+        fMaxGain = 0.0f;
+        fHysteresis = hysteresisDb;
+        
+        switch (iMode){
+            case GAIN_UPWARD:   fSlopeBelow = 1.0f / ratio - 1.0f; fMinGain = 0.0f; fMaxGain = rangeDb; break;
+            case GAIN_EXPAND:   fSlopeBelow = ratio - 1.0f; break;
+            case GAIN_GATE:     fSlopeBelow = kGateRatio - 1.0f; break;
+            default:            fSlopeAbove = 1.0f / ratio - 1.0f; fHysteresis = 0.0f; break;       //no use for hysteresis when compressing
+        }
+        prepare();
+    }
+    
+    // works out the derived values - call again after changing the coefficients directly
+    void prepare()
+    {
+        fHalfKnee = 0.5f * fKnee;
+        fInvTwoKnee = fKnee > 0.0f ? 0.5f / fKnee : 0.0f;
+        fThreshGain = powf(10.0f, 0.05f * fThresh);
+        fHysteresisGain = powf(10.0f, 0.05f * fHysteresis);
+    }
+    
+    bool sameCurve(const GainComputer& other) const
+    {
+        return fThresh == other.fThresh && fKnee == other.fKnee && fSlopeBelow == other.fSlopeBelow
+            && fSlopeAbove == other.fSlopeAbove && fMinGain == other.fMinGain && fMaxGain == other.fMaxGain;
+    }
+    
+    // gain (dB) for an input level (dB), leaving hysteresis aside
+    float getGainDb(float x) const
+    {
+        float d = x - fThresh;
+        float fKneeD = d < -fHalfKnee ? -fHalfKnee : (d > fHalfKnee ? fHalfKnee : d);
+        float q = fKneeD + fHalfKnee;
+        float fPast = d > fHalfKnee ? d - fHalfKnee : 0.0f;
+        float g = fSlopeBelow * d + (fSlopeAbove - fSlopeBelow) * (q * q * fInvTwoKnee + fPast);
+        return g < fMinGain ? fMinGain : (g > fMaxGain ? fMaxGain : g);
+    }
+    
+    // levels (dB) in, gains (dB) out, in place - pfOpen holds each lane's hysteresis state (0 or 1).
+    // Hysteresis only moves the switching point: a lane opens above the threshold and closes
+    // below threshold - hysteresis, and in between an open lane is held at the threshold's gain.
+    void process(float* pfLevel, float* pfOpen, int iNumLanes) const
+    {
+#if EFFECT_USE_SSE
+        const __m128 vThresh = _mm_set1_ps(fThresh), vHalfKnee = _mm_set1_ps(fHalfKnee), vInvTwoKnee = _mm_set1_ps(fInvTwoKnee);
+        const __m128 vBelow = _mm_set1_ps(fSlopeBelow), vChange = _mm_set1_ps(fSlopeAbove - fSlopeBelow);
+        const __m128 vMin = _mm_set1_ps(fMinGain), vMax = _mm_set1_ps(fMaxGain), vHysteresis = _mm_set1_ps(fHysteresis);
+        const __m128 vOne = _mm_set1_ps(1.0f), vZero = _mm_setzero_ps();
+        
+        for (int l = 0; l < iNumLanes; l += 4){
+            __m128 vLevel = _mm_loadu_ps(pfLevel + l);
+            __m128 vOpenMask = _mm_cmpgt_ps(_mm_add_ps(vLevel, _mm_mul_ps(_mm_loadu_ps(pfOpen + l), vHysteresis)), vThresh);
+            __m128 vOpen = _mm_and_ps(vOpenMask, vOne);
+            __m128 vX = _mm_or_ps(_mm_and_ps(vOpenMask, _mm_max_ps(vLevel, vThresh)), _mm_andnot_ps(vOpenMask, vLevel));
+            
+            __m128 vD = _mm_sub_ps(vX, vThresh);
+            __m128 vQ = _mm_add_ps(_mm_min_ps(_mm_max_ps(vD, _mm_sub_ps(vZero, vHalfKnee)), vHalfKnee), vHalfKnee);
+            __m128 vPast = _mm_max_ps(_mm_sub_ps(vD, vHalfKnee), vZero);
+            __m128 vGain = _mm_add_ps(_mm_mul_ps(vBelow, vD), _mm_mul_ps(vChange, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(vQ, vQ), vInvTwoKnee), vPast)));
+            
+            _mm_storeu_ps(pfLevel + l, _mm_min_ps(_mm_max_ps(vGain, vMin), vMax));
+            _mm_storeu_ps(pfOpen + l, vOpen);
+        }
+#else
+        for (int l = 0; l < iNumLanes; l++){
+            float x = pfLevel[l];
+            pfOpen[l] = x + pfOpen[l] * fHysteresis > fThresh ? 1.0f : 0.0f;
+            pfLevel[l] = getGainDb(pfOpen[l] != 0.0f && x < fThresh ? fThresh : x);
+        }
+#endif
+    }
+    
+    // as process() for one linear level, ready to look up in a tabulated curve
+    float applyHysteresis(float level, float& open) const
+    {
+        open = level * ((open != 0.0f) ? fHysteresisGain : 1.0f) > fThreshGain ? 1.0f : 0.0f;
+        return (open != 0.0f && level < fThreshGain) ? fThreshGain : level;
+    }
+    
+    float fThresh, fKnee, fSlopeBelow, fSlopeAbove, fMinGain, fMaxGain, fHysteresis;
+    float fHalfKnee, fInvTwoKnee, fThreshGain, fHysteresisGain;    // derived by prepare()
+};
+
 class Peak
 {
 public:
@@ -18,7 +164,8 @@ public:
         fMax = fMaxOld = fMaxNew = 0.0;
     }
     
-    float process(float fIn, double fAttack, double fRelease)
+    // the held peak level, before smoothing (see EnvelopeBank)
+    float measure(float fIn)
     {
         fAval = fabs(fIn);                                                              //peak level detector
         
@@ -34,44 +181,20 @@ public:
             fMaxNew = log10(fMax * 39 + 1) / fLog40;
             fMax = iMeasuredItems = 0;
         }
-        
-        Float32 coeff = (fMaxNew > fMaxOld) ? fAttack : fRelease;
-        return fMaxOld = coeff * fMaxNew + (1 - coeff) * fMaxOld;
+        return fMaxNew;
     }
     
-    float compress (float input, float thresh, float ratio, float kneeWidth)
+    float process(float fIn, double fAttack, double fRelease)
     {
-        float x = 20.0f * log10f(input);
-        float valueToSquare = x - thresh + (kneeWidth / 2.0);
-        float absolute = fabs(x - thresh);
-
-        if (2 * (x - thresh) < -kneeWidth){
-            y = x;                                                                                      //no compression
-        }
-        else if (2 * absolute <= kneeWidth){
-            y = x + (((1.0 / ratio - 1.0) * (valueToSquare * valueToSquare)) / (kneeWidth * 2.0));       //second order interpolation for soft knee
-        }
-        else if (2 * (x - thresh) > kneeWidth){
-            y = thresh + (x - thresh) / ratio;                                                              //hard knee
-        }
+        measure(fIn);
         
-        linX = powf(10.0f, 0.05f * x);                                                                  //convert decibel result to linear gain multiplier
-        linY = powf(10.0f, 0.05f * y);
-        
-        if(input <= 0){
-            return 1;
-        }
-        else{
-            return linY / linX;
-        }
+        Float32 coeff = (fMaxNew > fMaxOld) ? fAttack : fRelease;
+        return fMaxOld = coeff * fMaxNew + (1 - coeff) * fMaxOld;
     }
     
     int iMeasuredLength, iMeasuredItems;
     float fMax, fMaxOld, fMaxNew, fAval, fThresh, fRatio, fKneeWidth;
     const float fLog40 = log10(40);
-    float kneeResult;
-    float y = 0.0;
-    float output, linY, linX;
     
     
 private:
@@ -81,6 +204,7 @@ private:
 class RMS
 {
 public:
+    RMS() : oldSum(0.0), newSum(0.0) {}
     
     void initialise()
     {
@@ -88,7 +212,8 @@ public:
         
     }
     
-    float process (float fIn, double fAttack, double fRelease)
+    // the level of the last full window, before smoothing (see EnvelopeBank)
+    float measure (float fIn)
     {
         fAval = fabs(fIn);                                                                      //RMS level detector
         
@@ -103,6 +228,12 @@ public:
             newSum = log10(fSumOfSamples * 39 + 1) / log10(40);
             initialise();
         }
+        return newSum;
+    }
+    
+    float process (float fIn, double fAttack, double fRelease)
+    {
+        measure(fIn);
         
         Float32 coeff = (newSum > oldSum) ? fAttack : fRelease;
         return oldSum = coeff * newSum + (1 - coeff) * oldSum;
@@ -117,6 +248,1033 @@ private:
     
 };
 
+//==========================================================================
+// HalfBand - 2x polyphase half-band FIR stage (Kaiser-windowed sinc).
+// Every other tap of a half-band filter is zero, and the odd phase is just the
+// centre tap (a pure delay), so only the even taps are stored (scaled by 2 for
+// interpolation gain). Tables are multiples of 4 long for the SSE dot product.
+
+const int kHalfBandMaxTaps = 32;
+
+const float kHalfBandShort[8] = {                                                   // 15 taps, ~46dB - upper stages of a cascade
+    -0.001351362f, 0.025412505f, -0.125359373f, 0.601298229f,
+    0.601298229f, -0.125359373f, 0.025412505f, -0.001351362f
+};
+
+const float kHalfBandMedium[16] = {                                                 // 31 taps, ~80dB below 0.375
+    -0.000099256f, 0.001284465f, -0.005468701f, 0.016040116f,
+    -0.038454000f, 0.083070654f, -0.182443564f, 0.626070287f,
+    0.626070287f, -0.182443564f, 0.083070654f, -0.038454000f,
+    0.016040116f, -0.005468701f, 0.001284465f, -0.000099256f
+};
+
+const float kHalfBandLong[32] = {                                                   // 63 taps, ~85dB below 0.3 - first stage
+    -0.000007293f, 0.000059178f, -0.000211140f, 0.000561688f,
+    -0.001261625f, 0.002525183f, -0.004640666f, 0.007983764f,
+    -0.013042533f, 0.020475495f, -0.031254762f, 0.047034367f,
+    -0.071196005f, 0.112457717f, -0.202966159f, 0.633482792f,
+    0.633482792f, -0.202966159f, 0.112457717f, -0.071196005f,
+    0.047034367f, -0.031254762f, 0.020475495f, -0.013042533f,
+    0.007983764f, -0.004640666f, 0.002525183f, -0.001261625f,
+    0.000561688f, -0.000211140f, 0.000059178f, -0.000007293f
+};
+
+class HalfBand
+{
+public:
+    HalfBand()
+    {
+        initialise(kHalfBandShort, 8);
+    }
+    
+    void initialise(const float* taps, int length)
+    {
+        pfTaps = taps;
+        iLength = length;
+        reset();
+    }
+    
+    void reset()
+    {
+        for (int i = 0; i < 2 * kHalfBandMaxTaps; i++){
+            fEven[i] = fOdd[i] = 0.0;
+        }
+        iPos = 0;
+    }
+    
+    // one base rate sample in, two samples out at twice the rate
+    void interpolate(float fIn, float* pfOut)
+    {
+        push(fEven, fIn);
+        pfOut[0] = dot(fEven + iPos);
+        pfOut[1] = fEven[iPos + iLength / 2 - 1];                                        //centre tap phase is a delayed copy of the input
+    }
+    
+    // two samples in at twice the rate, one base rate sample out
+    float decimate(float fIn0, float fIn1)
+    {
+        push(fEven, fIn0);
+        fOdd[iPos] = fOdd[iPos + iLength] = fIn1;
+        return 0.5f * (dot(fEven + iPos) + fOdd[iPos + iLength / 2]);
+    }
+    
+    // group delay of one interpolate or decimate pass, in base rate samples
+    float getDelay() const
+    {
+        return (iLength - 1) * 0.5f;
+    }
+    
+private:
+    void push(float* pfHistory, float fIn)
+    {
+        if (--iPos < 0){
+            iPos += iLength;
+        }
+        pfHistory[iPos] = pfHistory[iPos + iLength] = fIn;                              //mirrored so the window is always contiguous
+    }
+    
+    float dot(const float* pfHistory) const
+    {
+#if EFFECT_USE_SSE
+        __m128 sum = _mm_setzero_ps();
+        for (int j = 0; j < iLength; j += 4){
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pfHistory + j), _mm_loadu_ps(pfTaps + j)));
+        }
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+#else
+        float sum[4] = {0.0, 0.0, 0.0, 0.0};
+        for (int j = 0; j < iLength; j += 4){
+            for (int k = 0; k < 4; k++){
+                sum[k] += pfHistory[j + k] * pfTaps[j + k];
+            }
+        }
+        return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+    }
+    
+    const float* pfTaps;
+    int iLength, iPos;
+    float fEven[2 * kHalfBandMaxTaps], fOdd[2 * kHalfBandMaxTaps];
+};
+
+//==========================================================================
+// TruePeak - oversampled peak measurement for the detector sidechain.
+// Returns the largest magnitude of the 4x/8x interpolated signal for each base
+// rate sample, so inter-sample peaks reach the detector. The audio path is untouched.
+
+class TruePeak
+{
+public:
+    TruePeak()
+    {
+        initialise(1);
+    }
+    
+    void initialise(int factor)
+    {
+        iStages = 0;
+        while ((1 << iStages) < factor && iStages < 3){
+            iStages++;
+        }
+        
+        stage[0].initialise(kHalfBandLong, 32);                                          //base rate stage carries the audio band, so needs the steep filter
+        stage[1].initialise(kHalfBandShort, 8);
+        stage[2].initialise(kHalfBandShort, 8);
+    }
+    
+    int getFactor() const
+    {
+        return 1 << iStages;
+    }
+    
+    // how far the peaks lag the input, in base rate samples
+    float getDelay() const
+    {
+        float fDelay = 0.0;
+        for (int s = 0; s < iStages; s++){
+            fDelay += stage[s].getDelay() / (1 << s);                                   //later stages run at higher rates
+        }
+        return fDelay;
+    }
+    
+    float process(float fIn)
+    {
+        float fBuffer[2][8];
+        float *pfSrc = fBuffer[0], *pfDst = fBuffer[1];
+        int iCount = 1;
+        
+        pfSrc[0] = fIn;
+        
+        for (int s = 0; s < iStages; s++){
+            for (int i = 0; i < iCount; i++){
+                stage[s].interpolate(pfSrc[i], pfDst + 2 * i);
+            }
+            iCount *= 2;
+            float *pfTemp = pfSrc; pfSrc = pfDst; pfDst = pfTemp;
+        }
+        
+        float fMax = 0.0;
+        for (int i = 0; i < iCount; i++){
+            float fAval = fabs(pfSrc[i]);
+            if (fAval > fMax){
+                fMax = fAval;
+            }
+        }
+        return fMax;
+    }
+    
+    // clears the filters' history, keeping the factor
+    void reset()
+    {
+        for (int s = 0; s < 3; s++){
+            stage[s].reset();
+        }
+    }
+    
+private:
+    HalfBand stage[3];
+    int iStages;
+};
+
+//==========================================================================
+// OversampledGain - applies a base rate gain signal at 2x/4x so the sidebands
+// of fast gain changes fold back above the audio band instead of into it.
+// The gain is delayed to line up with the interpolated audio and ramped
+// linearly across each group of oversampled points. All state is fixed size.
+
+const int kGainDelayLength = 32;
+
+class OversampledGain
+{
+public:
+    OversampledGain()
+    {
+        initialise(1, false);
+    }
+    
+    void initialise(int factor, bool bHighQuality)
+    {
+        iStages = factor >= 4 ? 2 : (factor >= 2 ? 1 : 0);
+        
+        for (int s = 0; s < 2; s++){
+            const float* pfTaps = (s == 0) ? (bHighQuality ? kHalfBandLong : kHalfBandMedium)
+                                           : (bHighQuality ? kHalfBandMedium : kHalfBandShort);
+            int iLength = (s == 0) ? (bHighQuality ? 32 : 16) : (bHighQuality ? 16 : 8);
+            up[s].initialise(pfTaps, iLength);
+            down[s].initialise(pfTaps, iLength);
+        }
+        
+        float fDelay = 0.0, fScale = 1.0;
+        for (int s = 0; s < iStages; s++){
+            fDelay += up[s].getDelay() * fScale;                                        //later stages run faster, so their delay counts for less
+            fScale *= 0.5;
+        }
+        iGainDelay = (int)(fDelay + 0.5);
+        iLatency = (int)(2.0 * fDelay + 0.5);
+        
+        for (int i = 0; i < kGainDelayLength; i++){
+            fGainHistory[i] = 1.0;
+        }
+        iGainPos = 0;
+        fLastGain = 1.0;
+    }
+    
+    int getFactor() const
+    {
+        return 1 << iStages;
+    }
+    
+    // round trip delay added to the audio, in base rate samples
+    int getLatency() const
+    {
+        return iStages ? iLatency : 0;
+    }
+    
+    float process(float fIn, float fGain)
+    {
+        float fBuffer[2][4];
+        float *pfSrc = fBuffer[0], *pfDst = fBuffer[1], *pfTemp;
+        int iCount = 1;
+        
+        pfSrc[0] = fIn;
+        for (int s = 0; s < iStages; s++){
+            for (int i = 0; i < iCount; i++){
+                up[s].interpolate(pfSrc[i], pfDst + 2 * i);
+            }
+            iCount *= 2;
+            pfTemp = pfSrc; pfSrc = pfDst; pfDst = pfTemp;
+        }
+        
+        fGainHistory[iGainPos] = fGain;
+        int iReadPos = iGainPos - iGainDelay;
+        if (iReadPos < 0){
+            iReadPos += kGainDelayLength;
+        }
+        if (++iGainPos == kGainDelayLength){
+            iGainPos = 0;
+        }
+        
+        float fTarget = fGainHistory[iReadPos];
+        float fStep = (fTarget - fLastGain) / iCount;
+        for (int i = 0; i < iCount; i++){
+            pfSrc[i] *= fLastGain + fStep * (i + 1);                                    //interpolated gain at the oversampled rate
+        }
+        fLastGain = fTarget;
+        
+        for (int s = iStages - 1; s >= 0; s--){
+            iCount /= 2;
+            for (int i = 0; i < iCount; i++){
+                pfDst[i] = down[s].decimate(pfSrc[2 * i], pfSrc[2 * i + 1]);
+            }
+            pfTemp = pfSrc; pfSrc = pfDst; pfDst = pfTemp;
+        }
+        
+        return pfSrc[0];
+    }
+    
+private:
+    HalfBand up[2], down[2];
+    int iStages, iGainDelay, iLatency, iGainPos;
+    float fGainHistory[kGainDelayLength];
+    float fLastGain;
+};
+
+//==========================================================================
+// Crossover coefficients - the same Butterworth low/high pass pair as
+// LPF::setCutoff and HPF::setCutoff, returned as { b0, b1, b2, a1, a2 } so
+// they can be worked out ahead of time and blended. Any blend of two stable
+// sets is itself stable (the stable region of a1/a2 is a triangle).
+
+inline void crossoverCoefficients(float fFrequency, double fSampleRate, double fLpf[5], double fHpf[5])
+{
+    Float32 fOmega = M_PI * (fFrequency / fSampleRate);
+    Float32 fKval = tan(fOmega);
+    Float32 fKvalsq = fKval * fKval;
+    Float32 fRootTwo = sqrt(2.0);
+    Float32 ffrac = 1.0 / (1.0 + fRootTwo * fKval + fKvalsq);
+    
+    fLpf[0] = fKvalsq * ffrac;
+    fLpf[1] = 2.0 * fKvalsq * ffrac;
+    fLpf[2] = fKvalsq * ffrac;
+    fHpf[0] = ffrac;
+    fHpf[1] = -2.0 * ffrac;
+    fHpf[2] = ffrac;
+    
+    fLpf[3] = fHpf[3] = 2.0 * (fKvalsq - 1.0) * ffrac;
+    fLpf[4] = fHpf[4] = (1.0 - fRootTwo * fKval + fKvalsq) * ffrac;
+}
+
+//==========================================================================
+// BiquadBank - a direct form I biquad per lane (one per channel), the same structure
+// as stk::BiQuad but with its coefficients and state held in SampleType. At low
+// cutoffs and high sample rates a1 and a2 sit very close to -2 and 1, and float state
+// in the feedback path loses enough precision to shift the response and raise the
+// noise floor - double is the one for mastering, float the cheaper one for tracking.
+// The lanes share one set of coefficients, and each state variable is a row across
+// them so every channel is filtered at once: two lanes a register in double
+// precision, four in float.
+
+template <int kLanes, typename SampleType = double>
+class BiquadBank
+{
+public:
+    BiquadBank() : b0(1.0), b1(0.0), b2(0.0), a1(0.0), a2(0.0)
+    {
+        clear();
+    }
+    
+    void setCoefficients(const double fCoefficients[5])
+    {
+        b0 = fCoefficients[0];
+        b1 = fCoefficients[1];
+        b2 = fCoefficients[2];
+        a1 = fCoefficients[3];
+        a2 = fCoefficients[4];
+    }
+    
+    void clear()
+    {
+        for (int l = 0; l < kLanes; l++){
+            x1[l] = x2[l] = y1[l] = y2[l] = 0.0;
+        }
+    }
+    
+    // takes over another bank's coefficients and state, so a switch of precision carries on where it was
+    template <typename OtherType>
+    void copyFrom(const BiquadBank<kLanes, OtherType>& other)
+    {
+        b0 = other.b0;
+        b1 = other.b1;
+        b2 = other.b2;
+        a1 = other.a1;
+        a2 = other.a2;
+        for (int l = 0; l < kLanes; l++){
+            x1[l] = other.x1[l];
+            x2[l] = other.x2[l];
+            y1[l] = other.y1[l];
+            y2[l] = other.y2[l];
+        }
+    }
+    
+    // filters one sample per lane, in place - lanes past iNumLanes are left alone
+    void process(SampleType* pfLanes, int iNumLanes)
+    {
+        int l = processVector(pfLanes, iNumLanes);
+        for (; l < iNumLanes; l++){                                                     //odd lanes left over, or no SSE
+            SampleType fIn = pfLanes[l];
+            SampleType fOut = b0 * fIn + b1 * x1[l] + b2 * x2[l];
+            fOut -= a2 * y2[l] + a1 * y1[l];
+            
+            x2[l] = x1[l];
+            x1[l] = fIn;
+            y2[l] = y1[l];
+            y1[l] = fOut;
+            pfLanes[l] = fOut;
+        }
+    }
+    
+private:
+    template <int, typename> friend class BiquadBank;
+    
+    // whole registers of lanes, returning the first lane left for the scalar loop
+    int processVector(double* pfLanes, int iNumLanes)
+    {
+        int l = 0;
+#if EFFECT_USE_SSE
+        const __m128d vB0 = _mm_set1_pd(b0), vB1 = _mm_set1_pd(b1), vB2 = _mm_set1_pd(b2);
+        const __m128d vA1 = _mm_set1_pd(a1), vA2 = _mm_set1_pd(a2);
+        
+        for (; l + 2 <= iNumLanes; l += 2){
+            __m128d vIn = _mm_loadu_pd(pfLanes + l), vX1 = _mm_loadu_pd(x1 + l), vY1 = _mm_loadu_pd(y1 + l);
+            __m128d vOut = _mm_add_pd(_mm_add_pd(_mm_mul_pd(vB0, vIn), _mm_mul_pd(vB1, vX1)), _mm_mul_pd(vB2, _mm_loadu_pd(x2 + l)));
+            vOut = _mm_sub_pd(vOut, _mm_add_pd(_mm_mul_pd(vA2, _mm_loadu_pd(y2 + l)), _mm_mul_pd(vA1, vY1)));
+            
+            _mm_storeu_pd(x2 + l, vX1);
+            _mm_storeu_pd(x1 + l, vIn);
+            _mm_storeu_pd(y2 + l, vY1);
+            _mm_storeu_pd(y1 + l, vOut);
+            _mm_storeu_pd(pfLanes + l, vOut);
+        }
+#endif
+        return l;
+    }
+    
+    int processVector(float* pfLanes, int iNumLanes)
+    {
+        int l = 0;
+#if EFFECT_USE_SSE
+        const __m128 vB0 = _mm_set1_ps(b0), vB1 = _mm_set1_ps(b1), vB2 = _mm_set1_ps(b2);
+        const __m128 vA1 = _mm_set1_ps(a1), vA2 = _mm_set1_ps(a2);
+        
+        for (; l + 4 <= iNumLanes; l += 4){
+            __m128 vIn = _mm_loadu_ps(pfLanes + l), vX1 = _mm_loadu_ps(x1 + l), vY1 = _mm_loadu_ps(y1 + l);
+            __m128 vOut = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vB0, vIn), _mm_mul_ps(vB1, vX1)), _mm_mul_ps(vB2, _mm_loadu_ps(x2 + l)));
+            vOut = _mm_sub_ps(vOut, _mm_add_ps(_mm_mul_ps(vA2, _mm_loadu_ps(y2 + l)), _mm_mul_ps(vA1, vY1)));
+            
+            _mm_storeu_ps(x2 + l, vX1);
+            _mm_storeu_ps(x1 + l, vIn);
+            _mm_storeu_ps(y2 + l, vY1);
+            _mm_storeu_ps(y1 + l, vOut);
+            _mm_storeu_ps(pfLanes + l, vOut);
+        }
+#endif
+        return l;
+    }
+    
+    SampleType b0, b1, b2, a1, a2;
+    SampleType x1[kLanes], x2[kLanes], y1[kLanes], y2[kLanes];
+};
+
+//==========================================================================
+// Crossover - splits each lane into a high and a low band with a pair of BiquadBanks.
+// The high band is inverted on the way in, so the two bands sum back flat.
 
+template <int kLanes, typename SampleType = double>
+class Crossover
+{
+public:
+    void setCoefficients(const double fLpf[5], const double fHpf[5])
+    {
+        lowPass.setCoefficients(fLpf);
+        highPass.setCoefficients(fHpf);
+    }
+    
+    void clear()
+    {
+        lowPass.clear();
+        highPass.clear();
+    }
+    
+    template <typename OtherType>
+    void copyFrom(const Crossover<kLanes, OtherType>& other)
+    {
+        lowPass.copyFrom(other.lowPass);
+        highPass.copyFrom(other.highPass);
+    }
+    
+    // one sample per lane in, [lane][0] the high band and [lane][1] the low band out
+    void process(const float* pfIn, float (*pfBand)[2], int iNumLanes)
+    {
+        SampleType fHigh[kLanes], fLow[kLanes];
+        for (int l = 0; l < iNumLanes; l++){
+            fHigh[l] = pfIn[l] * -1.0;
+            fLow[l] = pfIn[l];
+        }
+        highPass.process(fHigh, iNumLanes);
+        lowPass.process(fLow, iNumLanes);
+        for (int l = 0; l < iNumLanes; l++){
+            pfBand[l][0] = fHigh[l];
+            pfBand[l][1] = fLow[l];
+        }
+    }
+    
+private:
+    template <int, typename> friend class Crossover;
+    
+    BiquadBank<kLanes, SampleType> lowPass, highPass;
+};
 
+//==========================================================================
+// GainCurve - the gain a GainComputer gives, tabulated against the detector level.
+// The table is indexed straight from the float's bit pattern: the exponent picks
+// the octave and the top mantissa bits the step within it, so there is no log on
+// the way in and no pow on the way out - one read and a linear interpolation.
+// It is only rebuilt when the computer's curve changes, or can be built from
+// a user TransferCurve - either way, looking up a gain costs the same.
 
+class GainCurve
+{
+public:
+    enum
+    {
+        kMinOctave = -20,                                   // 2^-20, about -120dB
+        kOctaves = 24,                                      // up to 2^4, about +24dB
+        kStepBits = 6,                                      // 64 steps per octave
+        kSize = kOctaves << kStepBits,
+        kFractionBits = 23 - kStepBits,
+    };
+    
+    GainCurve() : bBuilt(false) {}
+    
+    void update(const GainComputer& computer)
+    {
+        if (bBuilt && computer.sameCurve(built)){
+            return;
+        }
+        built = computer;
+        bBuilt = true;
+        
+        for (int k = 0; k <= kSize; k++){
+            float fLevel = bitsToFloat(getBaseBits() + (k << kFractionBits));
+            fTable[k] = powf(10.0f, 0.05f * computer.getGainDb(20.0f * log10f(fLevel)));
+        }
+    }
+    
+    void update(const TransferCurve& curve)
+    {
+        bBuilt = false;                                     // so the next computer update rebuilds
+        
+        for (int k = 0; k <= kSize; k++){
+            float fLevel = bitsToFloat(getBaseBits() + (k << kFractionBits));
+            float x = 20.0f * log10f(fLevel);
+            float y = transferCurve(curve, x);
+            fTable[k] = powf(10.0f, 0.05f * y) / powf(10.0f, 0.05f * x);
+        }
+    }
+    
+    // levels at or below the bottom of the table (silence included) get the gain at its floor
+    float getGain(float input) const
+    {
+        int iOffset = floatToBits(input) - getBaseBits();
+        if (iOffset <= 0){
+            return fTable[0];
+        }
+        
+        int iIndex = iOffset >> kFractionBits;
+        if (iIndex >= kSize){
+            return fTable[kSize];
+        }
+        
+        float fFrac = (iOffset & ((1 << kFractionBits) - 1)) * (1.0f / (1 << kFractionBits));
+        return fTable[iIndex] + fFrac * (fTable[iIndex + 1] - fTable[iIndex]);
+    }
+    
+    // the quietest level the table covers - anything below is treated as this
+    static float getFloorLevel()                { return bitsToFloat(getBaseBits()); }
+    
+private:
+    static int getBaseBits()                    { return (127 + kMinOctave) << 23; }
+    
+    static int floatToBits(float f)             { int i; memcpy(&i, &f, sizeof(i)); return i; }
+    static float bitsToFloat(int i)             { float f; memcpy(&f, &i, sizeof(f)); return f; }
+    
+    GainComputer built;
+    bool bBuilt;
+    float fTable[kSize + 1];
+};
+
+//==========================================================================
+// EnvelopeBank - attack/release smoothing for a row of detectors (one per channel),
+// run four at a time. Times are in ms; the coefficients, 1 - exp(-1 / (time * rate)),
+// are only worked out again when a time or the sample rate changes, so a setting
+// gives the same time constant at any rate.
+//   ENVELOPE_BRANCHING - one pole, using the attack coefficient while the level rises
+//                        and the release coefficient while it falls
+//   ENVELOPE_DECOUPLED - a release peak-hold followed by an attack one pole, so the
+//                        two times don't interact (no attack overshoot on long releases)
+// Auto release runs a second, slower release (kAutoReleaseFactor times longer) alongside
+// the set one and blends towards it the longer the level has been over the threshold -
+// transients recover at the set release, sustained material at the slow one.
+
+enum ENVELOPE_MODE { ENVELOPE_BRANCHING, ENVELOPE_DECOUPLED };
+
+template <int kLanes>
+class EnvelopeBank
+{
+public:
+    enum { kAutoReleaseFactor = 8 };
+    
+    EnvelopeBank() : fAttackMs(-1.0), fReleaseMs(-1.0), fRate(0.0), fAttackCoeff(1.0), fReleaseCoeff(1.0), fSlowCoeff(1.0),
+                     bAutoRelease(false), fThresholdDb(0.0), fThreshold(1.0)
+    {
+        for (int l = 0; l < kLanes; l++){
+            fState[l] = fHold[l] = fSlowState[l] = fSlowHold[l] = fOver[l] = 0.0;
+        }
+    }
+    
+    // threshold in dB, as the gain computer sees it - only used for auto release
+    void setAutoRelease(bool bAuto, float thresholdDb)
+    {
+        bAutoRelease = bAuto;
+        if (thresholdDb != fThresholdDb){
+            fThresholdDb = thresholdDb;
+            fThreshold = powf(10.0f, 0.05f * thresholdDb);
+        }
+    }
+    
+    void setTimes(double attackMs, double releaseMs, double sampleRate)
+    {
+        if (attackMs == fAttackMs && releaseMs == fReleaseMs && sampleRate == fRate){
+            return;
+        }
+        fAttackMs = attackMs;
+        fReleaseMs = releaseMs;
+        fRate = sampleRate;
+        fAttackCoeff = getCoefficient(attackMs, sampleRate);
+        fReleaseCoeff = getCoefficient(releaseMs, sampleRate);
+        fSlowCoeff = getCoefficient(releaseMs * kAutoReleaseFactor, sampleRate);
+    }
+    
+    // smooths pfIn[0..iNumLanes) into pfOut - both must have room for iNumLanes rounded up to 4
+    void process(const float* pfIn, float* pfOut, int iNumLanes, int iMode)
+    {
+        if (bAutoRelease){
+            processAuto(pfIn, pfOut, iNumLanes, iMode);
+            return;
+        }
+        
+#if EFFECT_USE_SSE
+        const __m128 vAttack = _mm_set1_ps(fAttackCoeff), vRelease = _mm_set1_ps(fReleaseCoeff), vOne = _mm_set1_ps(1.0f);
+        
+        if (iMode == ENVELOPE_BRANCHING){
+            for (int l = 0; l < iNumLanes; l += 4){
+                __m128 vIn = _mm_loadu_ps(pfIn + l), vState = _mm_loadu_ps(fState + l);
+                __m128 vRising = _mm_cmpgt_ps(vIn, vState);
+                __m128 vCoeff = _mm_or_ps(_mm_and_ps(vRising, vAttack), _mm_andnot_ps(vRising, vRelease));
+                vState = _mm_add_ps(_mm_mul_ps(vCoeff, vIn), _mm_mul_ps(_mm_sub_ps(vOne, vCoeff), vState));
+                _mm_storeu_ps(fState + l, vState);
+                _mm_storeu_ps(pfOut + l, vState);
+            }
+        }
+        else{
+            for (int l = 0; l < iNumLanes; l += 4){
+                __m128 vIn = _mm_loadu_ps(pfIn + l), vState = _mm_loadu_ps(fState + l), vHold = _mm_loadu_ps(fHold + l);
+                vHold = _mm_max_ps(vIn, _mm_add_ps(_mm_mul_ps(vRelease, vIn), _mm_mul_ps(_mm_sub_ps(vOne, vRelease), vHold)));
+                vState = _mm_add_ps(_mm_mul_ps(vAttack, vHold), _mm_mul_ps(_mm_sub_ps(vOne, vAttack), vState));
+                _mm_storeu_ps(fHold + l, vHold);
+                _mm_storeu_ps(fState + l, vState);
+                _mm_storeu_ps(pfOut + l, vState);
+            }
+        }
+#else
+        for (int l = 0; l < iNumLanes; l++){
+            if (iMode == ENVELOPE_BRANCHING){
+                float fCoeff = (pfIn[l] > fState[l]) ? fAttackCoeff : fReleaseCoeff;
+                fState[l] = fCoeff * pfIn[l] + (1 - fCoeff) * fState[l];
+            }
+            else{
+                float fRelease = fReleaseCoeff * pfIn[l] + (1 - fReleaseCoeff) * fHold[l];
+                fHold[l] = pfIn[l] > fRelease ? pfIn[l] : fRelease;
+                fState[l] = fAttackCoeff * fHold[l] + (1 - fAttackCoeff) * fState[l];
+            }
+            pfOut[l] = fState[l];
+        }
+#endif
+    }
+    
+private:
+    // as process(), with the slow release and the over-threshold weight as extra state
+    // carried through the same pass
+    void processAuto(const float* pfIn, float* pfOut, int iNumLanes, int iMode)
+    {
+#if EFFECT_USE_SSE
+        const __m128 vAttack = _mm_set1_ps(fAttackCoeff), vRelease = _mm_set1_ps(fReleaseCoeff), vSlow = _mm_set1_ps(fSlowCoeff);
+        const __m128 vOne = _mm_set1_ps(1.0f), vThreshold = _mm_set1_ps(fThreshold);
+        
+        for (int l = 0; l < iNumLanes; l += 4){
+            __m128 vIn = _mm_loadu_ps(pfIn + l), vState = _mm_loadu_ps(fState + l), vSlowState = _mm_loadu_ps(fSlowState + l);
+            __m128 vOver = _mm_loadu_ps(fOver + l);
+            
+            __m128 vIsOver = _mm_and_ps(_mm_cmpgt_ps(vIn, vThreshold), vOne);
+            vOver = _mm_add_ps(_mm_mul_ps(vSlow, vIsOver), _mm_mul_ps(_mm_sub_ps(vOne, vSlow), vOver));
+            
+            if (iMode == ENVELOPE_BRANCHING){
+                __m128 vRising = _mm_cmpgt_ps(vIn, vState);
+                __m128 vCoeff = _mm_or_ps(_mm_and_ps(vRising, vAttack), _mm_andnot_ps(vRising, vRelease));
+                vState = _mm_add_ps(_mm_mul_ps(vCoeff, vIn), _mm_mul_ps(_mm_sub_ps(vOne, vCoeff), vState));
+                
+                vRising = _mm_cmpgt_ps(vIn, vSlowState);
+                vCoeff = _mm_or_ps(_mm_and_ps(vRising, vAttack), _mm_andnot_ps(vRising, vSlow));
+                vSlowState = _mm_add_ps(_mm_mul_ps(vCoeff, vIn), _mm_mul_ps(_mm_sub_ps(vOne, vCoeff), vSlowState));
+                
+                _mm_storeu_ps(fState + l, vState);
+                _mm_storeu_ps(fSlowState + l, vSlowState);
+                _mm_storeu_ps(pfOut + l, _mm_add_ps(vState, _mm_mul_ps(vOver, _mm_sub_ps(vSlowState, vState))));
+            }
+            else{
+                __m128 vHold = _mm_loadu_ps(fHold + l), vSlowHold = _mm_loadu_ps(fSlowHold + l);
+                vHold = _mm_max_ps(vIn, _mm_add_ps(_mm_mul_ps(vRelease, vIn), _mm_mul_ps(_mm_sub_ps(vOne, vRelease), vHold)));
+                vSlowHold = _mm_max_ps(vIn, _mm_add_ps(_mm_mul_ps(vSlow, vIn), _mm_mul_ps(_mm_sub_ps(vOne, vSlow), vSlowHold)));
+                
+                __m128 vBlend = _mm_add_ps(vHold, _mm_mul_ps(vOver, _mm_sub_ps(vSlowHold, vHold)));
+                vState = _mm_add_ps(_mm_mul_ps(vAttack, vBlend), _mm_mul_ps(_mm_sub_ps(vOne, vAttack), vState));
+                
+                _mm_storeu_ps(fHold + l, vHold);
+                _mm_storeu_ps(fSlowHold + l, vSlowHold);
+                _mm_storeu_ps(fState + l, vState);
+                _mm_storeu_ps(pfOut + l, vState);
+            }
+            _mm_storeu_ps(fOver + l, vOver);
+        }
+#else
+        for (int l = 0; l < iNumLanes; l++){
+            float fIsOver = pfIn[l] > fThreshold ? 1.0f : 0.0f;
+            fOver[l] = fSlowCoeff * fIsOver + (1 - fSlowCoeff) * fOver[l];
+            
+            if (iMode == ENVELOPE_BRANCHING){
+                float fCoeff = (pfIn[l] > fState[l]) ? fAttackCoeff : fReleaseCoeff;
+                fState[l] = fCoeff * pfIn[l] + (1 - fCoeff) * fState[l];
+                fCoeff = (pfIn[l] > fSlowState[l]) ? fAttackCoeff : fSlowCoeff;
+                fSlowState[l] = fCoeff * pfIn[l] + (1 - fCoeff) * fSlowState[l];
+                pfOut[l] = fState[l] + fOver[l] * (fSlowState[l] - fState[l]);
+            }
+            else{
+                float fRelease = fReleaseCoeff * pfIn[l] + (1 - fReleaseCoeff) * fHold[l];
+                fHold[l] = pfIn[l] > fRelease ? pfIn[l] : fRelease;
+                fRelease = fSlowCoeff * pfIn[l] + (1 - fSlowCoeff) * fSlowHold[l];
+                fSlowHold[l] = pfIn[l] > fRelease ? pfIn[l] : fRelease;
+                float fBlend = fHold[l] + fOver[l] * (fSlowHold[l] - fHold[l]);
+                fState[l] = fAttackCoeff * fBlend + (1 - fAttackCoeff) * fState[l];
+                pfOut[l] = fState[l];
+            }
+        }
+#endif
+    }
+    
+    static float getCoefficient(double timeMs, double sampleRate)
+    {
+        return timeMs > 0.0 ? (float) (1.0 - exp(-1000.0 / (timeMs * sampleRate))) : 1.0f;
+    }
+    
+    double fAttackMs, fReleaseMs, fRate;
+    float fAttackCoeff, fReleaseCoeff, fSlowCoeff;
+    bool bAutoRelease;
+    float fThresholdDb, fThreshold;
+    float fState[kLanes], fHold[kLanes];
+    float fSlowState[kLanes], fSlowHold[kLanes], fOver[kLanes];     // auto release only
+};
+
+//==========================================================================
+// Detector topology - where the detectors listen.
+//   DETECTOR_FEEDFORWARD - the band before gain is applied
+//   DETECTOR_FEEDBACK    - the band after the previous sample's gain, as an output-sensing
+//                          compressor would hear it
+//   DETECTOR_HYBRID      - halfway between the two in dB (the square root of that gain)
+// The one sample recursion is per lane, so a row of channels still goes four at a time.
+// Arrays are read in fours, so need room for a whole number of them, with the lanes past
+// iNumLanes initialised.
+
+enum DETECTOR_TOPOLOGY { DETECTOR_FEEDFORWARD, DETECTOR_FEEDBACK, DETECTOR_HYBRID };
+
+inline void applyDetectorTopology(float* pfDetect, const float* pfLastGain, int iNumLanes, int iTopology)
+{
+    if (iTopology == DETECTOR_FEEDFORWARD){
+        return;
+    }
+    
+#if EFFECT_USE_SSE
+    for (int l = 0; l < iNumLanes; l += 4){
+        __m128 vGain = _mm_loadu_ps(pfLastGain + l);
+        if (iTopology == DETECTOR_HYBRID){
+            vGain = _mm_sqrt_ps(vGain);
+        }
+        _mm_storeu_ps(pfDetect + l, _mm_mul_ps(_mm_loadu_ps(pfDetect + l), vGain));
+    }
+#else
+    for (int l = 0; l < iNumLanes; l++){
+        pfDetect[l] *= (iTopology == DETECTOR_HYBRID) ? sqrtf(pfLastGain[l]) : pfLastGain[l];
+    }
+#endif
+}
+
+//==========================================================================
+// LookaheadLimiter - brickwall gain for peak levels that arrive ahead of the audio they
+// belong to. The gain each peak needs is held (sliding window minimum) for iHold samples,
+// released with a one pole and then averaged over iRamp samples, so it ramps down in a
+// straight line and is fully down iRamp samples after the peak was seen - the ramp should
+// be no longer than the lookahead, the hold long enough to cover the peak coming out.
+// The minimum uses a monotonic queue, so the cost doesn't grow with the window.
+
+class LookaheadLimiter
+{
+public:
+    LookaheadLimiter() : iMaxLength(0), iRamp(0), iHold(0), fReleaseCoeff(1.0) {}
+    
+    void initialise(int maxLength)
+    {
+        iMaxLength = maxLength > 1 ? maxLength : 1;
+        pfQueueGain.calloc(iMaxLength + 2);
+        piQueueTime.calloc(iMaxLength + 2);
+        pfAverage.calloc(iMaxLength);
+        iRamp = iHold = 1;
+        reset();
+    }
+    
+    void setWindow(int ramp, int hold)
+    {
+        ramp = jlimit(1, iMaxLength, ramp);
+        hold = jlimit(ramp, iMaxLength, hold);
+        if (ramp != iRamp || hold != iHold){
+            iRamp = ramp;
+            iHold = hold;
+            reset();
+        }
+    }
+    
+    void setRelease(double releaseMs, double sampleRate)
+    {
+        fReleaseCoeff = (float) (1.0 - exp(-1000.0 / (releaseMs * sampleRate)));
+    }
+    
+    void reset()
+    {
+        iTime = iHead = iTail = iAveragePos = 0;
+        fReleased = 1.0;
+        fAverageSum = iRamp;
+        for (int k = 0; k < iRamp; k++){
+            pfAverage[k] = 1.0;
+        }
+    }
+    
+    // peak level entering the lookahead in, gain for the sample leaving it out
+    float process(float peak, float ceiling)
+    {
+        float fNeeded = peak > ceiling ? ceiling / peak : 1.0f;
+        const int iSize = iMaxLength + 2;
+        
+        while (iTail != iHead && pfQueueGain[(iTail + iSize - 1) % iSize] >= fNeeded){
+            iTail = (iTail + iSize - 1) % iSize;                                  //drop gains that can no longer be the minimum
+        }
+        pfQueueGain[iTail] = fNeeded;
+        piQueueTime[iTail] = iTime;
+        iTail = (iTail + 1) % iSize;
+        if ((int) (iTime - piQueueTime[iHead]) > iHold){
+            iHead = (iHead + 1) % iSize;                                            //oldest one has left the window
+        }
+        iTime++;
+        
+        float fHeld = pfQueueGain[iHead];
+        fReleased = fHeld < fReleased ? fHeld : fReleased + fReleaseCoeff * (fHeld - fReleased);
+        
+        fAverageSum += fReleased - pfAverage[iAveragePos];
+        pfAverage[iAveragePos] = fReleased;
+        if (++iAveragePos == iRamp){
+            iAveragePos = 0;
+        }
+        return (float) (fAverageSum / iRamp);
+    }
+    
+private:
+    HeapBlock<float> pfQueueGain, pfAverage;
+    HeapBlock<unsigned int> piQueueTime;
+    int iMaxLength, iRamp, iHold, iHead, iTail, iAveragePos;
+    unsigned int iTime;                                                             // wraps safely - only differences are used
+    float fReleaseCoeff, fReleased;
+    double fAverageSum;
+};
+
+//==========================================================================
+// LoudnessMeter - ITU-R BS.1770 loudness, streamed a block at a time. Each channel is
+// K-weighted (the standard's high shelf and high pass, designed for the running rate)
+// and its weighted mean square gathered into 100ms steps. Momentary and short-term
+// loudness average the last 4 and 30 steps. Integrated loudness gates the overlapping
+// 400ms momentary windows at -70 LUFS and again 10 LU below their mean; the windows
+// are kept as a 0.1 LU histogram, so the gate never has to look back at old audio.
+
+template <int kChannels, typename SampleType = double>
+class LoudnessMeter
+{
+public:
+    enum
+    {
+        kMomentarySteps = 4,
+        kShortTermSteps = 30,
+        kMinLoudness = -70,                                 // the absolute gate, and the floor reported
+        kBinsPerLU = 10,
+        kBins = 80 * kBinsPerLU,                            // -70 to +10 LUFS
+    };
+    
+    LoudnessMeter() : iStepLength(1)
+    {
+        reset();
+    }
+    
+    void initialise(double sampleRate)
+    {
+        double K = tan(M_PI * 1681.974450955533 / sampleRate);                       //stage 1 - high shelf, +4dB above 1.5kHz
+        double Vh = pow(10.0, 3.999843853973347 / 20.0), Vb = pow(Vh, 0.4996667741545416), Q = 0.7071752369554196;
+        double a0 = 1.0 + K / Q + K * K;
+        double shelf[5] = { (Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+                            2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 };
+        
+        K = tan(M_PI * 38.13547087602444 / sampleRate);                              //stage 2 - RLB high pass
+        Q = 0.5003270373238773;
+        a0 = 1.0 + K / Q + K * K;
+        double highPass[5] = { 1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 };
+        
+        stage1.setCoefficients(shelf);
+        stage2.setCoefficients(highPass);
+        iStepLength = (int)(0.1 * sampleRate);
+        reset();
+    }
+    
+    void reset()
+    {
+        stage1.clear();
+        stage2.clear();
+        for (int s = 0; s < kShortTermSteps; s++){
+            fStepPower[s] = 0.0;
+        }
+        for (int b = 0; b < kBins; b++){
+            fBinPower[b] = 0.0;
+            iBinCount[b] = 0;
+        }
+        fSum = 0.0;
+        iStepSamples = iSteps = iStepPos = 0;
+        fMomentary = fShortTerm = fIntegrated = kMinLoudness;
+    }
+    
+    // returns how many 100ms steps finished in the block
+    int process(const float* const* ppfChannels, int numChannels, int numSamples)
+    {
+        numChannels = numChannels < kChannels ? numChannels : kChannels;
+        int iFinished = 0;
+        
+        for (int n = 0; n < numSamples; n++){
+            SampleType fWeighted[kChannels];
+            for (int c = 0; c < numChannels; c++){
+                fWeighted[c] = ppfChannels[c][n];
+            }
+            stage1.process(fWeighted, numChannels);                                 //every channel through each stage at once
+            stage2.process(fWeighted, numChannels);
+            for (int c = 0; c < numChannels; c++){
+                fSum += getChannelWeight(c, numChannels) * fWeighted[c] * fWeighted[c];
+            }
+            if (++iStepSamples == iStepLength){
+                finishStep();
+                iFinished++;
+            }
+        }
+        return iFinished;
+    }
+    
+    float getMomentary() const          { return fMomentary; }
+    float getShortTerm() const          { return fShortTerm; }
+    float getIntegrated() const         { return fIntegrated; }
+    
+private:
+    // 5.1 in L R C LFE Ls Rs order leaves out the LFE and lifts the surrounds; otherwise all count alike
+    static double getChannelWeight(int c, int numChannels)
+    {
+        if (numChannels == 6 && c >= 3){
+            return c == 3 ? 0.0 : 1.41;
+        }
+        return 1.0;
+    }
+    
+    static float toLoudness(double power)
+    {
+        float fLoudness = power > 0.0 ? (float)(-0.691 + 10.0 * log10(power)) : (float) kMinLoudness;
+        return fLoudness > kMinLoudness ? fLoudness : (float) kMinLoudness;
+    }
+    
+    double getMeanPower(int numSteps) const
+    {
+        double fTotal = 0.0;
+        for (int s = 0; s < numSteps; s++){
+            fTotal += fStepPower[(iStepPos + kShortTermSteps - 1 - s) % kShortTermSteps];
+        }
+        return fTotal / numSteps;
+    }
+    
+    void finishStep()
+    {
+        fStepPower[iStepPos] = fSum / iStepLength;
+        iStepPos = (iStepPos + 1) % kShortTermSteps;
+        fSum = 0.0;
+        iStepSamples = 0;
+        iSteps++;
+        
+        int iMomentary = iSteps < kMomentarySteps ? iSteps : kMomentarySteps;
+        int iShortTerm = iSteps < kShortTermSteps ? iSteps : kShortTermSteps;
+        double fWindowPower = getMeanPower(iMomentary);
+        fMomentary = toLoudness(fWindowPower);
+        fShortTerm = toLoudness(getMeanPower(iShortTerm));
+        
+        if (iSteps < kMomentarySteps){
+            return;                                                                 //no whole 400ms window yet
+        }
+        float fLoudness = -0.691 + 10.0 * log10(fWindowPower > 0.0 ? fWindowPower : 1e-20);
+        if (fLoudness <= kMinLoudness){
+            return;                                                                 //absolute gate
+        }
+        int iBin = jmin((int)((fLoudness - kMinLoudness) * kBinsPerLU), kBins - 1);
+        fBinPower[iBin] += fWindowPower;
+        iBinCount[iBin]++;
+        
+        double fTotal = 0.0;
+        int iCount = 0;
+        for (int b = 0; b < kBins; b++){
+            fTotal += fBinPower[b];
+            iCount += iBinCount[b];
+        }
+        float fGate = toLoudness(fTotal / iCount) - 10.0;                            //relative gate
+        int iFirstBin = jmax(0, (int)((fGate - kMinLoudness) * kBinsPerLU));
+        
+        fTotal = 0.0;
+        iCount = 0;
+        for (int b = iFirstBin; b < kBins; b++){
+            fTotal += fBinPower[b];
+            iCount += iBinCount[b];
+        }
+        fIntegrated = iCount ? toLoudness(fTotal / iCount) : (float) kMinLoudness;
+    }
+    
+    BiquadBank<kChannels, SampleType> stage1, stage2;
+    double fSum, fStepPower[kShortTermSteps], fBinPower[kBins];
+    int iBinCount[kBins];
+    int iStepLength, iStepSamples, iSteps, iStepPos;
+    float fMomentary, fShortTerm, fIntegrated;
+};
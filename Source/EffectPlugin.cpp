@@ -11,6 +11,25 @@
 // EFFECT - represents the whole effect plugin
 ////////////////////////////////////////////////////////////////////////////
 
+// Factory transfer curves for the Curve menu, as (input, output, knee) in dB - the
+// menu's first item is the user curve set through setTransferCurve()
+namespace
+{
+    struct CurvePreset
+    {
+        int iNumPoints;
+        float fPoints[3][3];
+    };
+    
+    const CurvePreset kCurvePresets[] = {
+        { 2, {{-24.0, -24.0, 12.0}, {24.0, 8.0, 0.0}} },                                 //Gentle - 1.5:1 from -24dB, wide knee
+        { 2, {{-18.0, -18.0, 6.0}, {24.0, 3.0, 0.0}} },                                  //Glue - 2:1 from -18dB
+        { 3, {{-24.0, -24.0, 6.0}, {-10.0, -19.333, 4.0}, {24.0, -13.667, 0.0}} },      //Vocal - 3:1, then 6:1 above -10dB
+        { 3, {{-12.0, -12.0, 6.0}, {-3.0, -9.75, 2.0}, {24.0, -9.5, 0.0}} },            //Limit - 4:1, then nearly flat above -3dB
+        { 3, {{-80.0, -120.0, 0.0}, {-40.0, -40.0, 6.0}, {24.0, 24.0, 0.0}} },          //Expand - 1:2 below -40dB
+    };
+}
+
 // Called to create the effect (used to point JUCE to your effect)
 Effect* JUCE_CALLTYPE createEffect() {
     return new MyEffect();
@@ -20,24 +39,145 @@ Effect* JUCE_CALLTYPE createEffect() {
 void MyEffect::initialise()
 {
     // Initialise effect variables here
-    peak[0].initialise((int) (0.001 * getSampleRate()));
-    peak[1].initialise((int) (0.001 * getSampleRate()));
-    rms[0].initialise();
-    rms[1].initialise();
+    for (int x = 0; x < kMaxChannels; x++){
+        for (int i = 0; i < 2; i++){
+            peak[x][i].initialise((int) (0.001 * getSampleRate()));                     //one detector per channel and band
+            rms[x][i].initialise();
+        }
+        meterPeak[x].initialise((int) (0.001 * getSampleRate()));
+        meterRms[x].initialise();
+    }
     
     fSR = getSampleRate();
-    iBufferSize = (int)(2.0 * fSR);
-    pfCircularBuffer0 = new float[iBufferSize];
-    pfCircularBuffer1 = new float[iBufferSize];
-    
-    for(int iPos = 0; iPos < iBufferSize; iPos++){
-        pfCircularBuffer0[iPos] = 0;
-        pfCircularBuffer1[iPos] = 0;
+    iBufferSize = (int)(0.5 * fSR);                                                 //lookahead goes up to 200ms
+    pfDelayLines.calloc(kMaxChannels * 2 * iBufferSize);
+    limiter.initialise(2 * iBufferSize);                                            //room for the hold to outlast the lookahead
+    limiter.setRelease(kLimiterReleaseMs, fSR);
+    for (int x = 0; x < kMaxChannels; x++){
+        limiterPeak[x].initialise(kLimiterFactor);
     }
+    bLimiter = false;
+    fCeiling = 1.0;
+    iLatency = 0;
+    inputLoudness.initialise(fSR);
+    outputLoudness.initialise(fSR);
+    bAutoMakeup = false;
+    fAutoMakeupDb = 0.0;
+    fAutoMakeup = 1.0;
+    fAutoMakeupCoeff = 1.0 - exp(-1.0 / (0.05 * fSR));                              //50ms glide between loudness steps
     
     iBufferWritePos = 0;
+    iChannels = 2;
+    for (int x = 0; x < kMaxChannels; x++){
+        fComp[x][0] = fComp[x][1] = 1.0;                                            //feedback detectors start from unity gain
+        fGateOpen[0][x] = fGateOpen[1][x] = 0.0;
+    }
+    setLinkGroups(GROUPS_ALL);
+    
+    TransferCurve curve;                                                            //default custom curve: 2:1 from -20dB, limiting above -6dB
+    const float fDefault[3][3] = {{-20.0, -20.0, 6.0}, {-6.0, -13.0, 4.0}, {24.0, -12.0, 0.0}};
+    curve.iNumPoints = 3;
+    for (int k = 0; k < 3; k++){
+        curve.fInput[k] = fDefault[k][0];
+        curve.fOutput[k] = fDefault[k][1];
+        curve.fKnee[k] = fDefault[k][2];
+    }
+    setTransferCurve(0, curve);
+    setTransferCurve(1, curve);
+    for (int p = 0; p < (int) numElementsInArray(kCurvePresets); p++){
+        TransferCurve preset;
+        preset.iNumPoints = kCurvePresets[p].iNumPoints;
+        for (int k = 0; k < preset.iNumPoints; k++){
+            preset.fInput[k] = kCurvePresets[p].fPoints[k][0];
+            preset.fOutput[k] = kCurvePresets[p].fPoints[k][1];
+            preset.fKnee[k] = kCurvePresets[p].fPoints[k][2];
+        }
+        presetCurves.add(compileCurve(preset));                                    //compiled up front, so picking one is just a pointer
+    }
+    pCustomCurve[0] = activeCurve[0].get();
+    pCustomCurve[1] = activeCurve[1].get();
+    iTruePeakFactor = 1;
+    fCompType = 0;
+    fLastKeyCutoff = 0;
+    iGainFactor = 1;
+    iGainFadeSamples = 0;
+    bGainHighQuality = bGainTable = bCustomCurve = false;
+    iEnvelopeMode = ENVELOPE_BRANCHING;
+    bAutoRelease = false;
+    iDetectorTopology = DETECTOR_FEEDFORWARD;
+    iLinkMode = LINK_OFF;
+    fBandGain[0] = 1.0f;
+    fBandGain[1] = 1.0f;
+    fBandCrossover = 1000.0;
+    iHistoryCount = 0;
+    bDoublePrecision = true;
+    
+    float fValues[kNumberOfParameters];
+    for (int p = 0; p < kNumberOfParameters; p++){
+        fValues[p] = getParameter(p);
+    }
+    deriveSettings(fValues, current);
+    applyFilterSettings();
+    fadeFrom = target = current;
+    iFadeSamples = 0;
+    iFadeLength = (int)(0.02 * fSR);                                                //until prepare() knows the host's rate
+    iSettingsVersion = getSettingsVersion();
+    pendingSettings = NULL;
+}
 
+// Before playback: anything designed for the sample rate is redone for the host's
+void MyEffect::prepare(double sampleRate)
+{
+    fSR = sampleRate;                                                               //lookahead, limiter and Nyquist are all worked out from this
+    for (int x = 0; x < kMaxChannels; x++){
+        for (int i = 0; i < 2; i++){
+            peak[x][i].initialise((int) (0.001 * fSR));
+        }
+        meterPeak[x].initialise((int) (0.001 * fSR));
+    }
+    
+    iBufferSize = (int)(0.5 * fSR);                                                 //same 500ms of lookahead room at any rate
+    pfDelayLines.calloc(kMaxChannels * 2 * iBufferSize);
+    iBufferWritePos = 0;
+    limiter.initialise(2 * iBufferSize);
+    limiter.setRelease(kLimiterReleaseMs, fSR);
+    
+    inputLoudness.initialise(fSR);                                                  //K-weighting and the 100ms steps
+    outputLoudness.initialise(fSR);
+    fAutoMakeupCoeff = 1.0 - exp(-1.0 / (0.05 * fSR));
     
+    float fValues[kNumberOfParameters];
+    for (int p = 0; p < kNumberOfParameters; p++){
+        fValues[p] = getParameter(p);
+    }
+    deriveSettings(fValues, current);                                               //crossover and knee for the new rate
+    crossover.clear();
+    keyCrossover.clear();
+    crossoverFloat.clear();
+    keyCrossoverFloat.clear();
+    applyFilterSettings();
+    for (int x = 0; x < kMaxChannels; x++){
+        keyFilter[x].clear();
+    }
+    fadeFrom = target = current;
+    iSettingsVersion = getSettingsVersion();
+    
+    iFadeLength = (int)(0.02 * fSR);                                                //20ms crossfade between programs
+    iFadeSamples = 0;
+    iGainFadeSamples = 0;
+    retiredSettings.clear();                                                        //nothing can be reading them while stopped
+    for (int k = compiledCurves.size(); --k >= 0;){
+        if (compiledCurves[k] != activeCurve[0].get() && compiledCurves[k] != activeCurve[1].get()){
+            compiledCurves.remove(k);                                               //replaced curves go the same way
+        }
+    }
+}
+
+// Audio thread: each pass of the transport gets its own integrated loudness
+void MyEffect::transportStarted()
+{
+    inputLoudness.reset();
+    outputLoudness.reset();
 }
 
 void MyEffect::cleanup()
@@ -63,19 +203,13 @@ void MyEffect::buttonPressed(int iButton)
     // A button, with index iButton, has been pressed
 }
 
-float MyEffect::delay(float *buffer, float input, float fLookahead)
+// One delay line per channel and band - they all share iBufferWritePos, which process() moves on once per sample
+float MyEffect::delay(int iLine, float input, int iDelaySamples)
 {
-    iBufferWritePos++;
-    if(iBufferWritePos == iBufferSize){
-        iBufferWritePos = 0;
-    }
-    
-    int truncatedLookahead = fLookahead * 100;
-    fLookahead = truncatedLookahead / 100.0;
-    
+    float *buffer = pfDelayLines + iLine * iBufferSize;
     buffer[iBufferWritePos] = input;
     
-    int iBufferReadPos = iBufferWritePos - (fLookahead * fSR);
+    int iBufferReadPos = iBufferWritePos - iDelaySamples;
     
     if(iBufferReadPos < 0){
         iBufferReadPos += iBufferSize;
@@ -84,36 +218,329 @@ float MyEffect::delay(float *buffer, float input, float fLookahead)
     return buffer[iBufferReadPos];
 }
 
-void MyEffect::compressAndSendToMeter(float fInput[][2], float fMeterLevel[][2], float fMakeupGain[], float fThreshold[], float fRatio[])
+// Message thread: tidies the curve and compiles its table, then publishes both together -
+// the audio thread picks the new one up at the start of its next block
+void MyEffect::setTransferCurve(int iBand, const TransferCurve& curve)
+{
+    if (!isPositiveAndBelow(iBand, 2)){
+        return;
+    }
+    
+    CompiledCurve* pCompiled = compileCurve(curve);
+    compiledCurves.add(pCompiled);
+    activeCurve[iBand] = pCompiled;                                                 //the old one stays valid until prepare()
+}
+
+// Message thread: sorts the breakpoints, drops duplicates and trims the knees, then builds the gain table
+CompiledCurve* MyEffect::compileCurve(const TransferCurve& curve)
+{
+    TransferCurve sorted;
+    sorted.iNumPoints = jlimit(0, (int) TransferCurve::kMaxPoints, curve.iNumPoints);
+    for (int k = 0; k < sorted.iNumPoints; k++){
+        float fInput = curve.fInput[k], fOutput = curve.fOutput[k], fKnee = curve.fKnee[k] > 0.0 ? curve.fKnee[k] : 0.0;
+        int j = k;
+        while (j > 0 && sorted.fInput[j - 1] > fInput){                                //insertion sort on the input level
+            sorted.fInput[j] = sorted.fInput[j - 1];
+            sorted.fOutput[j] = sorted.fOutput[j - 1];
+            sorted.fKnee[j] = sorted.fKnee[j - 1];
+            j--;
+        }
+        sorted.fInput[j] = fInput;
+        sorted.fOutput[j] = fOutput;
+        sorted.fKnee[j] = fKnee;
+    }
+    
+    int iKept = 0;
+    for (int k = 0; k < sorted.iNumPoints; k++){
+        if (iKept > 0 && sorted.fInput[k] == sorted.fInput[iKept - 1]){
+            continue;                                                               //a second point at the same level has no segment
+        }
+        sorted.fInput[iKept] = sorted.fInput[k];
+        sorted.fOutput[iKept] = sorted.fOutput[k];
+        sorted.fKnee[iKept] = sorted.fKnee[k];
+        iKept++;
+    }
+    sorted.iNumPoints = iKept;
+    
+    for (int k = 0; k < sorted.iNumPoints; k++){
+        if (k > 0 && sorted.fKnee[k] > sorted.fInput[k] - sorted.fInput[k - 1]){
+            sorted.fKnee[k] = sorted.fInput[k] - sorted.fInput[k - 1];              //knees can't reach past the neighbouring breakpoints
+        }
+        if (k + 1 < sorted.iNumPoints && sorted.fKnee[k] > sorted.fInput[k + 1] - sorted.fInput[k]){
+            sorted.fKnee[k] = sorted.fInput[k + 1] - sorted.fInput[k];
+        }
+    }
+    
+    CompiledCurve* pCompiled = new CompiledCurve();
+    pCompiled->curve = sorted;
+    pCompiled->gain.update(sorted);
+    pCompiled->fThresh = sorted.iNumPoints ? sorted.fInput[0] : 0.0;
+    return pCompiled;
+}
+
+void MyEffect::getTransferCurve(int iBand, TransferCurve& curve)
+{
+    if (isPositiveAndBelow(iBand, 2)){
+        curve = activeCurve[iBand].get()->curve;
+    }
+}
+
+// Works out which channels share a detector (or pull towards each other, for partial linking)
+void MyEffect::setLinkGroups(int iGroups)
 {
-    for (int x = 0; x < 2; x++){
+    for (int x = 0; x < kMaxChannels; x++){
+        iLinkLeader[x] = (iGroups == GROUPS_PAIRS) ? (x & ~1) : 0;                  //each group is led by its first channel
+    }
+}
+
+void MyEffect::compressAndSendToMeter(float fInput[][2], float fMeterLevel[][2], float fMakeupGain[], const GainComputer computer[])
+{
+    bool bTable = bGainTable && iFadeSamples == 0 && !bCustomCurve;                       //settings move every sample during a fade
+    
+    for (int i = 0; i < 2; i++){
+        float fGain[kMaxChannels];
+        if (bCustomCurve){
+            for (int x = 0; x < iChannels; x++){
+                fGain[x] = pCustomCurve[i]->gain.getGain(fMeterLevel[x][i]);                     //user curve - modes, threshold, ratio and knee don't apply
+            }
+        }
+        else if (bTable){
+            gainCurve[i].update(computer[i]);                                               //only rebuilds if the curve changed
+            for (int x = 0; x < iChannels; x++){
+                fGain[x] = gainCurve[i].getGain(computer[i].applyHysteresis(fMeterLevel[x][i], fGateOpen[i][x]));
+            }
+        }
+        else{
+            const float fFloor = GainCurve::getFloorLevel();                                //same floor as the table, so silence gets the same gain
+            for (int x = 0; x < iChannels; x++){
+                fGain[x] = 20.0f * log10f(fMeterLevel[x][i] > fFloor ? fMeterLevel[x][i] : fFloor);
+            }
+            for (int x = iChannels; x < ((iChannels + 3) & ~3); x++){
+                fGain[x] = -200.0f;                                                         //spare SSE lanes read as silence, so their gates stay shut
+            }
+            computer[i].process(fGain, fGateOpen[i], iChannels);                            //every channel through the band's curve at once
+            for (int x = 0; x < iChannels; x++){
+                fGain[x] = powf(10.0f, 0.05f * fGain[x]);
+            }
+        }
+        
+        for (int x = 0; x < iChannels; x++){
+            fComp[x][i] = fGain[x];                                                         //linked channels share a level, so a gain too
+        }
+    }
+    
+    for (int x = 0; x < iChannels; x++){
         for (int i = 0; i < 2; i++){
-            fComp[x][i] = peak[i].compress(fMeterLevel[x][i], fThreshold[i], fRatio[i], kneeWidth);
-            fCombinedSignal[x][i] = fInput[x][i] * fComp[x][i];
+            if (fComp[x][i] < fBlockGain[i]){
+                fBlockGain[i] = fComp[x][i];                                                //deepest gain reduction this block, for the display
+            }
+            if (iGainFadeSamples > 0){
+                float fMix = (float) iGainFadeSamples / iFadeLength;                        //old setting's share, falling to 0
+                fCombinedSignal[x][i] = fMix * osGainOld[x][i].process(fInput[x][i], fComp[x][i])
+                                      + (1.0f - fMix) * osGain[x][i].process(fInput[x][i], fComp[x][i]);
+            }
+            else if (iGainFactor > 1){
+                fCombinedSignal[x][i] = osGain[x][i].process(fInput[x][i], fComp[x][i]);  //apply gain at the oversampled rate
+            }
+            else{
+                fCombinedSignal[x][i] = fInput[x][i] * fComp[x][i];
+            }
         }
     }
          
-    float fHighPass = ((fCombinedSignal[0][0] + fCombinedSignal[1][0]) / 2.0 ) * fMakeupGain[0];
-    float fLowPass = ((fCombinedSignal[0][1] + fCombinedSignal[1][1]) / 2.0) * fMakeupGain[1];
+    float fBandSum[2] = {0.0, 0.0};
+    fTotalCompression = 0.0;
+    for (int x = 0; x < iChannels; x++){
+        for (int i = 0; i < 2; i++){
+            fBandSum[i] += fCombinedSignal[x][i];
+            fTotalCompression += fComp[x][i];
+            fCompOut[x][i] = fCombinedSignal[x][i] * fMakeupGain[i];
+        }
+    }
+    if (iGainFadeSamples > 0){
+        iGainFadeSamples--;
+    }
+    
+    float fHighPass = (fBandSum[0] / iChannels) * fMakeupGain[0];
+    float fLowPass = (fBandSum[1] / iChannels) * fMakeupGain[1];
     
     fCompMonoMix = (fHighPass + fLowPass) / 2.0;
+    fTotalCompression /= 2 * iChannels;
     
-    fTotalCompression = (fComp[0][0] + fComp[0][1] + fComp[1][0] + fComp[1][1]) / 4.0;
+    if (fCompType == 0){
+        setParameterValue(kParam4, fMonoPeak);                                             //versions are bumped once a block, in process()
+    }
+    else if (fCompType == 1){
+        setParameterValue(kParam5, fMonoRms);
+    }
+    
+    setParameterValue(kParam6, fTotalCompression);
+
+}
+
+int MyEffect::getLatencySamples()
+{
+    return iLatency + osGain[0][0].getLatency();
+}
+
+int MyEffect::getBandActivity(BandActivity* bands, int maxBands)
+{
+    if (maxBands < 2){
+        return 0;
+    }
+    
+    const float fCrossover = fBandCrossover.get();                                  //one read, so both bands agree
+    bands[0].fLowHz = fCrossover;                                                   //band 0 is the high-passed band
+    bands[0].fHighHz = 0.5 * fSR;
+    bands[0].fGain = fBandGain[0].get();
+    bands[1].fLowHz = 0.0;
+    bands[1].fHighHz = fCrossover;
+    bands[1].fGain = fBandGain[1].get();
+    return 2;
+}
+
+// The attack and release knobs have always been per-sample smoothing coefficients - kept as
+// they were at 44.1kHz, so existing settings sound the same there, but turned into times so
+// they mean the same at any other rate
+static double coefficientToMs(double fCoefficient)
+{
+    fCoefficient = jlimit(1.0e-9, 1.0, fCoefficient);
+    return fCoefficient < 1.0 ? -1000.0 / (44100.0 * log(1.0 - fCoefficient)) : 0.0;
+}
+
+// Works out everything process() needs from a set of parameter values
+void MyEffect::deriveSettings(const float* pfValues, EffectSettings& settings)
+{
+    const int iThresh[2] = {kParam0, kParam7}, iRatio[2] = {kParam1, kParam8}, iMakeup[2] = {kParam2, kParam9};
+    const int iMode[2] = {kParam29, kParam30}, iRange[2] = {kParam31, kParam32}, iHysteresis[2] = {kParam33, kParam34};
     
     for (int i = 0; i < 2; i++){
-        fLeftComp[i] = fCombinedSignal[0][i] * fMakeupGain[i];
-        fRightComp[i] = fCombinedSignal[1][i] * fMakeupGain[i];
+        settings.fThresh[i] = linearToDecibel(pfValues[iThresh[i]]);
+        if (settings.fThresh[i] < -100.0){
+            settings.fThresh[i] = -60.0;
+        }
+        settings.fMakeupGain[i] = 1.0 + linearToDecibel(pfValues[iMakeup[i]]);
+        settings.fRatio[i] = pfValues[iRatio[i]];
     }
     
-    if (fCompType == 0){
-        setParameter(kParam4, fMonoPeak);
+    settings.fKneeWidth = linearToDecibel(pfValues[kParam14]);
+    for (int i = 0; i < 2; i++){
+        settings.computer[i].set((int) pfValues[iMode[i]], settings.fThresh[i], settings.fRatio[i], settings.fKneeWidth,
+                                 pfValues[iRange[i]], pfValues[iHysteresis[i]]);
     }
-    else if (fCompType == 1){
-        setParameter(kParam5, fMonoRms);
+    settings.fCentreFreq = pfValues[kParam12];
+    settings.fAttackMs = coefficientToMs(0.1 - pfValues[kParam10]);
+    settings.fReleaseMs = coefficientToMs(0.1 - pfValues[kParam11]);
+    settings.fSampleRate = stk::Stk::sampleRate();
+    crossoverCoefficients(settings.fCentreFreq, settings.fSampleRate, settings.fLpf, settings.fHpf);
+}
+
+// Sum of the versions of every parameter deriveSettings reads - changes whenever any of them does
+int MyEffect::getSettingsVersion()
+{
+    const int iUsed[] = {kParam0, kParam1, kParam2, kParam7, kParam8, kParam9, kParam10, kParam11, kParam12, kParam14,
+                         kParam29, kParam30, kParam31, kParam32, kParam33, kParam34};
+    int iVersion = 0;
+    for (int p = 0; p < (int)(sizeof(iUsed) / sizeof(iUsed[0])); p++){
+        iVersion += getParameterVersion(iUsed[p]);
     }
+    return iVersion;
+}
+
+// Message thread: (re)derive a program's settings - called again if the sample rate changes.
+// The audio thread may be copying the old settings, so new ones are published alongside them
+// rather than written over them
+void MyEffect::cachePreset(int iPresetNum, const float* pfValues)
+{
+    EffectSettings* pSettings = new EffectSettings();
+    deriveSettings(pfValues, *pSettings);
     
-    setParameter(kParam6, fTotalCompression);
+    while (presetSettings.size() < iPresetNum){
+        presetSettings.add(new EffectSettings());
+    }
+    if (iPresetNum == presetSettings.size()){
+        presetSettings.add(pSettings);
+    }
+    else{
+        EffectSettings* pOld = presetSettings[iPresetNum];
+        presetSettings.set(iPresetNum, pSettings, false);
+        pendingSettings.compareAndSetBool(pSettings, pOld);                          //a pick the audio thread hasn't taken yet gets the new ones
+        retiredSettings.add(pOld);
+    }
+}
+
+// Message thread: the next block crossfades to the cached settings
+void MyEffect::selectPreset(int iPresetNum)
+{
+    if (isPositiveAndBelow(iPresetNum, presetSettings.size())){
+        pendingSettings = presetSettings[iPresetNum];
+    }
+}
 
+void MyEffect::startFade(const EffectSettings& settings)
+{
+    fadeFrom = current;                                                             //from wherever we are, even mid-fade
+    target = settings;
+    iFadeSamples = iFadeLength;
+}
+
+template <typename Type>
+static inline Type blend(Type from, Type to, float fMix)
+{
+    return from + fMix * (to - from);
+}
+
+static inline GainComputer blend(const GainComputer& from, const GainComputer& to, float fMix)
+{
+    GainComputer computer;                                                          //a change of mode fades through the coefficients too
+    computer.fThresh = blend(from.fThresh, to.fThresh, fMix);
+    computer.fKnee = blend(from.fKnee, to.fKnee, fMix);
+    computer.fSlopeBelow = blend(from.fSlopeBelow, to.fSlopeBelow, fMix);
+    computer.fSlopeAbove = blend(from.fSlopeAbove, to.fSlopeAbove, fMix);
+    computer.fMinGain = blend(from.fMinGain, to.fMinGain, fMix);
+    computer.fMaxGain = blend(from.fMaxGain, to.fMaxGain, fMix);
+    computer.fHysteresis = blend(from.fHysteresis, to.fHysteresis, fMix);
+    computer.prepare();
+    return computer;
+}
+
+void MyEffect::stepFade()
+{
+    if (--iFadeSamples <= 0){
+        iFadeSamples = 0;
+        current = target;
+    }
+    else{
+        float fMix = 1.0 - (float) iFadeSamples / iFadeLength;
+        for (int i = 0; i < 2; i++){
+            current.fThresh[i] = blend(fadeFrom.fThresh[i], target.fThresh[i], fMix);
+            current.fRatio[i] = blend(fadeFrom.fRatio[i], target.fRatio[i], fMix);
+            current.fMakeupGain[i] = blend(fadeFrom.fMakeupGain[i], target.fMakeupGain[i], fMix);
+            current.computer[i] = blend(fadeFrom.computer[i], target.computer[i], fMix);
+        }
+        current.fKneeWidth = blend(fadeFrom.fKneeWidth, target.fKneeWidth, fMix);
+        current.fCentreFreq = blend(fadeFrom.fCentreFreq, target.fCentreFreq, fMix);
+        current.fAttackMs = blend(fadeFrom.fAttackMs, target.fAttackMs, fMix);
+        current.fReleaseMs = blend(fadeFrom.fReleaseMs, target.fReleaseMs, fMix);
+        for (int c = 0; c < 5; c++){
+            current.fLpf[c] = blend(fadeFrom.fLpf[c], target.fLpf[c], fMix);          //blends of stable biquads stay stable
+            current.fHpf[c] = blend(fadeFrom.fHpf[c], target.fHpf[c], fMix);
+        }
+        current.fSampleRate = target.fSampleRate;
+    }
+    applyFilterSettings();
+}
+
+void MyEffect::applyFilterSettings()
+{
+    if (bDoublePrecision){
+        crossover.setCoefficients(current.fLpf, current.fHpf);                      //one set for every channel
+        keyCrossover.setCoefficients(current.fLpf, current.fHpf);
+    }
+    else{
+        crossoverFloat.setCoefficients(current.fLpf, current.fHpf);                 //only the precision in use is kept up to date
+        keyCrossoverFloat.setCoefficients(current.fLpf, current.fHpf);
+    }
 }
 
 float MyEffect::linearToDecibel(float parameter)
@@ -126,81 +553,418 @@ float MyEffect::linearToDecibel(float parameter)
 // (inputBuffer contains the input audio, and processed samples should be stored in outputBuffer)
 void MyEffect::process(float** inputBuffers, float** outputBuffers, int numSamples)
 {
-    float fIn[2];
-    float *pfInBuffer0 = inputBuffers[0], *pfInBuffer1 = inputBuffers[1];
-    float *pfOutBuffer0 = outputBuffers[0], *pfOutBuffer1 = outputBuffers[1];
-    float fBandPeakLevel[2][2], fBandRms[2][2];
-    float fThresh[2] = {getParameter(kParam0), getParameter(kParam7)};
-    float fMakeupGain[2] = {getParameter(kParam2), getParameter(kParam9)};
-    float fRatio[2] = {getParameter(kParam1), getParameter(kParam8)};
-    double fAttack = 0.1 - getParameter(kParam10);
-    fRelease = 0.1 - getParameter(kParam11);
-    float fCentreFreq = getParameter(kParam12);
+    float fIn[kMaxChannels];
+    float fBandPeakLevel[kMaxChannels][2], fBandRms[kMaxChannels][2];
     float convertToMono = getParameter(kParam13);
-    float fDelSig[2][2];
+    float fDelSig[kMaxChannels][2];
+    bool bSidechain = getParameter(kParam19) != 0 && pfSidechain != NULL;
+    float fKeyCutoff = getParameter(kParam20);
+    float *pfKey[kMaxChannels];
+    float fLinkAmount = getParameter(kParam22);
     
-    kneeWidth = getParameter(kParam14);
-    kneeWidth = linearToDecibel(kneeWidth);
-    fCompType = getParameter(kParam3);
-    fLookahead = getParameter(kParam15);
+    iChannels = jlimit(1, (int) kMaxChannels, iNumChannels);
+    bool bMidSide = getParameter(kParam23) == 1 && iChannels > 1;                    //mid/side applies to the first pair
+    iLinkMode = getParameter(kParam21);
+    setLinkGroups(getParameter(kParam24));
+    fBlockGain[0] = fBlockGain[1] = 1.0;
+    const float fMeterStart[3] = { getParameter(kParam4), getParameter(kParam5), getParameter(kParam6) };
     
+    bool bHistory = pGainHistory != NULL && pGainHistory->isActive();
+    if (bHistory){
+        pGainHistory->setNumBands(2);
+    }
+    
+    EffectSettings* pProgram = pendingSettings.exchange(NULL);
+    int iVersion = getSettingsVersion();
+    if (pProgram != NULL){
+        startFade(*pProgram);                                                        //program change - crossfade to its cached settings
+    }
+    else if (iVersion != iSettingsVersion || current.fSampleRate != stk::Stk::sampleRate()){
+        float fValues[kNumberOfParameters];
+        for (int p = 0; p < kNumberOfParameters; p++){
+            fValues[p] = getParameter(p);
+        }
+        
+        if (iFadeSamples > 0){
+            deriveSettings(fValues, target);                                         //edits made during a program fade retarget it
+        }
+        else{
+            deriveSettings(fValues, current);                                        //otherwise they apply straight away, as before
+            applyFilterSettings();
+        }
+    }
+    iSettingsVersion = iVersion;
+    
+    float fNewCompType = getParameter(kParam3);
+    if (fNewCompType != fCompType){
+        for (int x = 0; x < kMaxChannels; x++){
+            truePeak[x][0].reset();                                                  //only the peak detector feeds it, so its history is stale
+            truePeak[x][1].reset();
+        }
+    }
+    fCompType = fNewCompType;
+    bGainTable = getParameter(kParam25) == 1;
+    bCustomCurve = getParameter(kParam25) == 2;
+    iEnvelopeMode = getParameter(kParam26);
+    bAutoRelease = getParameter(kParam27) == 1;
+    iDetectorTopology = bSidechain ? DETECTOR_FEEDFORWARD : (int) getParameter(kParam28);   //an external key has no output to listen to
+    int iCurvePreset = getParameter(kParam42);
     for (int i = 0; i < 2; i++){
-        fThresh[i] = linearToDecibel(fThresh[i]);
-        fMakeupGain[i]  = 1.0 + linearToDecibel(fMakeupGain[i]);
+        if (iCurvePreset > 0 && iCurvePreset <= presetCurves.size()){
+            pCustomCurve[i] = presetCurves.getUnchecked(iCurvePreset - 1);          //a factory curve, for both bands
+        }
+        else{
+            pCustomCurve[i] = activeCurve[i].get();                                  //compiled and published by setTransferCurve()
+        }
+    }
+    int iTruePeakOption = getParameter(kParam16);
+    int iFactor = iTruePeakOption ? 2 << iTruePeakOption : 1;                         //Off, 4x, 8x
+    if (iFactor != iTruePeakFactor){
+        iTruePeakFactor = iFactor;
+        for (int x = 0; x < kMaxChannels; x++){
+            truePeak[x][0].initialise(iFactor);
+            truePeak[x][1].initialise(iFactor);
+        }
+    }
+    
+    fLookahead = getParameter(kParam15);
+    int iLookahead = (int)(fLookahead * 100) / 100.0 * fSR;                          //in 10ms steps
+    if (fCompType == 0 && iTruePeakFactor > 1){
+        iLookahead += (int) ceil(truePeak[0][0].getDelay());                         //delay the audio as long as the interpolator delays the peaks
+    }
+    
+    bool bLimiterWasOn = bLimiter;
+    bLimiter = getParameter(kParam35) == 1;
+    if (bLimiter){
+        int iDetectDelay = (int) ceil(limiterPeak[0].getDelay());
+        if (iLookahead < iDetectDelay + (int)(0.002 * fSR)){
+            iLookahead = iDetectDelay + (int)(0.002 * fSR);                            //the limiter's own lookahead - latency moves when it's toggled
+        }
+        fCeiling = powf(10.0f, 0.05f * getParameter(kParam36));
+        int iRamp = iLookahead - iDetectDelay;                                         //peaks are seen that much late
+        limiter.setWindow(iRamp, iRamp + osGain[0][0].getLatency() + 1);              //held until the peak has come out
+        if (! bLimiterWasOn){
+            limiter.reset();                                                           //nothing was fed to it while it was off
+            for (int x = 0; x < kMaxChannels; x++){
+                limiterPeak[x].reset();
+            }
+        }
+    }
+    iLatency = iLookahead;
+    
+    bAutoMakeup = getParameter(kParam37) == 1;
+    if (! bAutoMakeup){
+        fAutoMakeupDb = 0.0;
+    }
+    float fAutoMakeupTarget = powf(10.0f, 0.05f * fAutoMakeupDb);
+    float fMakeup[2];
+    
+    int iGainOption = getParameter(kParam17);
+    int iQualityOption = getParameter(kParam18);
+    iFactor = 1 << iGainOption;                                                      //Off, 2x, 4x
+    bool bHighQuality = (iQualityOption == 2) || (iQualityOption == 0 && isNonRealtime());
+    if (iFactor != iGainFactor || bHighQuality != bGainHighQuality){
+        iGainFactor = iFactor;
+        bGainHighQuality = bHighQuality;
+        for (int x = 0; x < kMaxChannels; x++){
+            for (int i = 0; i < 2; i++){
+                osGainOld[x][i] = osGain[x][i];                                         //keeps its filter state, so the switch can fade
+                osGain[x][i].initialise(iFactor, bHighQuality);
+            }
+        }
+        iGainFadeSamples = iFadeLength;
+    }
+    
+    bool bDouble = getParameter(kParam41) == 0;
+    if (bDouble != bDoublePrecision){
+        bDoublePrecision = bDouble;
+        if (bDouble){
+            crossover.copyFrom(crossoverFloat);                                      //carry the filter state over, so the switch doesn't click
+            keyCrossover.copyFrom(keyCrossoverFloat);
+        }
+        else{
+            crossoverFloat.copyFrom(crossover);
+            keyCrossoverFloat.copyFrom(keyCrossover);
+        }
+    }
+    
+    if (bSidechain){
+        for (int x = 0; x < kMaxChannels && x < iSidechainChannels; x++){
+            if (fKeyCutoff > 0.0){
+                if (fLastKeyCutoff == 0.0){
+                    keyFilter[x].clear();                                               //history from before it was switched off is stale
+                }
+                keyFilter[x].setCutoff(fKeyCutoff);                                     //key HPF runs over the whole block, in place
+                float *pfKeyChannel = pfSidechain[x];
+                for (int n = 0; n < numSamples; n++){
+                    pfKeyChannel[n] = keyFilter[x].tick(pfKeyChannel[n]);
+                }
+            }
+        }
         
-        if (fThresh[i] < -100.0){
-            fThresh[i] = -60.0;
+        for (int x = 0; x < iChannels; x++){
+            pfKey[x] = pfSidechain[x % iSidechainChannels];                               //a key with fewer channels is repeated across them
         }
     }
-
-    while(numSamples--)
+    fLastKeyCutoff = bSidechain ? fKeyCutoff : 0;
+    
+    for (int n = 0; n < numSamples; n++)
     {
-        fIn[0] = *pfInBuffer0++;                                                    // Get sample from input
-        fIn[1] = *pfInBuffer1++;
+        for (int x = 0; x < iChannels; x++){
+            fIn[x] = inputBuffers[x][n];                                            // Get sample from input
+        }
         
-        for (int i = 0; i < 2; i++){
-            lpf[i].setCutoff(fCentreFreq);                                           //set filter cutoffs around the centre frequency
-            hpf[i].setCutoff(fCentreFreq);
+        if (iFadeSamples > 0){
+            stepFade();                                                             //crossfade the derived settings, filters included
         }
+        if (bAutoMakeup){
+            fAutoMakeup += fAutoMakeupCoeff * (fAutoMakeupTarget - fAutoMakeup);
+        }
+        else{
+            fAutoMakeup = 1.0;
+        }
+        fMakeup[0] = current.fMakeupGain[0] * fAutoMakeup;                         //the knobs still set the balance between bands
+        fMakeup[1] = current.fMakeupGain[1] * fAutoMakeup;
         
-        for (int x = 0; x < 2; x++){
-                fBand[x][0] = hpf[x].tick(fIn[x] * -1.0);                           //filter signal for both left and right channel
-                fBand[x][1] = lpf[x].tick(fIn[x]);
-            }
+        float fSplit[kMaxChannels];
+        for (int x = 0; x < iChannels; x++){
+            fSplit[x] = fIn[x];
+        }
+        if (bMidSide){
+            fSplit[0] = 0.5 * (fIn[0] + fIn[1]);                                    //encode to mid/side on the way into the crossover
+            fSplit[1] = 0.5 * (fIn[0] - fIn[1]);
+        }
+        
+        if (bDoublePrecision){
+            crossover.process(fSplit, fBand, iChannels);                            //filter signal for each channel (or mid and side)
+        }
+        else{
+            crossoverFloat.process(fSplit, fBand, iChannels);
+        }
 
-        fMonoPeak = (peak[0].process(fIn[0], 0.1, 0.0003) + peak[1].process(fIn[1], 0.1, 0.0003)) / 2.0;     //get average mono peak and rms values
-        fMonoRms = (rms[0].process(fIn[0], 0.1, 0.0003) + rms[1].process(fIn[1], 0.1, 0.0003)) / 2.0;
+        float (*pfDetectBand)[2] = fBand;
+        if (bSidechain){
+            float fKey[kMaxChannels];
+            for (int x = 0; x < iChannels; x++){
+                fKey[x] = pfKey[x][n];
+            }
+            if (bMidSide){
+                float fKeyMid = 0.5 * (fKey[0] + fKey[1]);
+                fKey[1] = 0.5 * (fKey[0] - fKey[1]);
+                fKey[0] = fKeyMid;
+            }
+            if (bDoublePrecision){
+                keyCrossover.process(fKey, fKeyBand, iChannels);                      //split the key with its own crossover
+            }
+            else{
+                keyCrossoverFloat.process(fKey, fKeyBand, iChannels);
+            }
+            pfDetectBand = fKeyBand;
+        }
         
-        for (int x = 0; x < 2; x++){
-            fDelSig[x][0] = delay(pfCircularBuffer0, fBand[x][0], fLookahead);
-            fDelSig[x][1] = delay(pfCircularBuffer0, fBand[x][1], fLookahead);
+        float fPeakSum = 0.0, fRmsSum = 0.0;
+        for (int x = 0; x < iChannels; x++){
+            fPeakSum += meterPeak[x].process(fIn[x], 0.1, 0.0003);                   //get average mono peak and rms values
+            fRmsSum += meterRms[x].process(fIn[x], 0.1, 0.0003);
         }
+        fMonoPeak = fPeakSum / iChannels;
+        fMonoRms = fRmsSum / iChannels;
         
-        for (int x = 0; x < 2; x++){
-            for (int i = 0; i < 2; i++){
-                fBandPeakLevel[x][i] = peak[i].process(fBand[x][i], fAttack, fRelease);      //get stereo peak and rms values with attack and release times
-                fBandRms[x][i] = rms[i].process(fBand[x][i], fAttack, fRelease);
+        if (++iBufferWritePos == iBufferSize){
+            iBufferWritePos = 0;
+        }
+        for (int x = 0; x < iChannels; x++){
+            fDelSig[x][0] = delay(2 * x, fBand[x][0], iLookahead);
+            fDelSig[x][1] = delay(2 * x + 1, fBand[x][1], iLookahead);
+        }
+        
+        for (int i = 0; i < 2; i++){
+            float fDetect[kMaxChannels] = {0.0}, fRaw[kMaxChannels] = {0.0}, fSmoothed[kMaxChannels], fLastGain[kMaxChannels] = {0.0};
+            float (*pfLevel)[2] = (fCompType == 0) ? fBandPeakLevel : fBandRms;       //only the detector type in use is run
+            EnvelopeBank<kMaxChannels>& envelope = (fCompType == 0) ? peakEnvelope[i] : rmsEnvelope[i];
+            envelope.setTimes(current.fAttackMs, current.fReleaseMs, stk::Stk::sampleRate());
+            envelope.setAutoRelease(bAutoRelease, bCustomCurve ? pCustomCurve[i]->fThresh : current.fThresh[i]);
+            
+            for (int x = 0; x < iChannels; x++){
+                fDetect[x] = pfDetectBand[x][i];
+                fLastGain[x] = fComp[x][i];
+            }
+            applyDetectorTopology(fDetect, fLastGain, iChannels, iDetectorTopology);         //feedback - the band as the last sample's gain left it
+            for (int x = 0; x < iChannels; x++){
+                if (fCompType == 0 && iTruePeakFactor > 1){
+                    fDetect[x] = truePeak[x][i].process(fDetect[x]);                          //inter-sample peak of the band, sidechain only
+                }
+            }
+            
+            if (iLinkMode == LINK_MAX || iLinkMode == LINK_SUM){
+                for (int g = 0; g < iChannels; g++){
+                    if (iLinkLeader[g] != g){
+                        continue;                                                             //one detector per group, run by its first channel
+                    }
+                    
+                    float fKey = 0.0;
+                    int iCount = 0;
+                    for (int x = g; x < iChannels; x++){
+                        if (iLinkLeader[x] != g){
+                            continue;
+                        }
+                        float fAbs = fabs(fDetect[x]);
+                        if (iLinkMode == LINK_MAX){
+                            fKey = fAbs > fKey ? fAbs : fKey;
+                        }
+                        else if (fCompType == 0){
+                            fKey += fAbs;
+                        }
+                        else{
+                            fKey += fAbs * fAbs;                                                  //power sum for the rms detector
+                        }
+                        iCount++;
+                    }
+                    if (iLinkMode == LINK_SUM){
+                        fKey = (fCompType == 0) ? fKey / iCount : sqrt(fKey / iCount);
+                    }
+                    
+                    fRaw[g] = (fCompType == 0) ? peak[g][i].measure(fKey) : rms[g][i].measure(fKey);   //single detector on the combined key
+                }
+                for (int x = 0; x < iChannels; x++){
+                    fRaw[x] = fRaw[iLinkLeader[x]];                                               //members track their group's level
+                }
+                
+                envelope.process(fRaw, fSmoothed, iChannels, iEnvelopeMode);
+                for (int x = 0; x < iChannels; x++){
+                    pfLevel[x][i] = fSmoothed[iLinkLeader[x]];
+                }
+            }
+            else{
+                for (int x = 0; x < iChannels; x++){
+                    fRaw[x] = (fCompType == 0) ? peak[x][i].measure(fDetect[x]) : rms[x][i].measure(fDetect[x]);
+                }
+                
+                envelope.process(fRaw, fSmoothed, iChannels, iEnvelopeMode);                    //attack and release for every channel at once
+                for (int x = 0; x < iChannels; x++){
+                    pfLevel[x][i] = fSmoothed[x];
+                }
+                
+                if (iLinkMode == LINK_PARTIAL){
+                    float fLoudest[kMaxChannels];
+                    for (int x = 0; x < iChannels; x++){
+                        int g = iLinkLeader[x];
+                        if (g == x || pfLevel[x][i] > fLoudest[g]){
+                            fLoudest[g] = pfLevel[x][i];                                        //loudest channel in each group
+                        }
+                    }
+                    for (int x = 0; x < iChannels; x++){
+                        pfLevel[x][i] += fLinkAmount * (fLoudest[iLinkLeader[x]] - pfLevel[x][i]);
+                    }
+                }
             }
         }
         
         if (fCompType == 0){
-            setParameter(kParam5, 0.0);                                                             //reset rms metre
-            compressAndSendToMeter(fDelSig, fBandPeakLevel, fMakeupGain, fThresh, fRatio);            //compress the signal based on the peak metre reading
+            setParameterValue(kParam5, 0.0);                                                        //reset rms metre
+            compressAndSendToMeter(fDelSig, fBandPeakLevel, fMakeup, current.computer);            //compress the signal based on the peak metre reading
         }
         else if (fCompType == 1){
-            setParameter(kParam4, 0.0);
-            compressAndSendToMeter(fDelSig, fBandRms, fMakeupGain, fThresh, fRatio);                  //compress the signal based on the rms metre reading
+            setParameterValue(kParam4, 0.0);
+            compressAndSendToMeter(fDelSig, fBandRms, fMakeup, current.computer);                  //compress the signal based on the rms metre reading
+        }
+        
+        if (bHistory){
+            for (int i = 0; i < 2; i++){
+                float fLow = fComp[0][i], fHigh = fComp[0][i], fSum = 0.0;
+                for (int x = 0; x < iChannels; x++){
+                    fLow = fComp[x][i] < fLow ? fComp[x][i] : fLow;
+                    fHigh = fComp[x][i] > fHigh ? fComp[x][i] : fHigh;
+                    fSum += fComp[x][i];
+                }
+                if (iHistoryCount == 0){
+                    historyFrame.fMin[i] = fLow;
+                    historyFrame.fMax[i] = fHigh;
+                    fHistorySum[i] = 0.0;
+                }
+                else{
+                    historyFrame.fMin[i] = fLow < historyFrame.fMin[i] ? fLow : historyFrame.fMin[i];
+                    historyFrame.fMax[i] = fHigh > historyFrame.fMax[i] ? fHigh : historyFrame.fMax[i];
+                }
+                fHistorySum[i] += fSum;
+            }
+            
+            if (++iHistoryCount == GainHistoryTap::kHopSamples){
+                for (int i = 0; i < 2; i++){
+                    historyFrame.fMean[i] = fHistorySum[i] / ((float) iChannels * GainHistoryTap::kHopSamples);
+                }
+                pGainHistory->write(historyFrame);                                                  //one min/max/mean frame per hop for the history view
+                iHistoryCount = 0;
+            }
+        }
+        
+        for (int x = 0; x < iChannels; x++){
+            if (convertToMono == 0){
+                outputBuffers[x][n] = (fCompOut[x][0] + fCompOut[x][1]) / 2.0;                      //output compressed signal
+            }
+            else if (convertToMono == 1){
+                outputBuffers[x][n] = fCompMonoMix;                                                 //output mono compressed signal
+            }
         }
         
-        if (convertToMono == 0){
-            *pfOutBuffer0++ = (fLeftComp[0] + fLeftComp[1]) / 2.0;                                  //output stereo compressed signal
-            *pfOutBuffer1++ = (fRightComp[0] + fRightComp[1]) / 2.0;
+        if (bMidSide){
+            float fMid = (fCompOut[0][0] + fCompOut[0][1]) / 2.0;                                   //band summation and mid/side decode in one step
+            float fSide = (convertToMono == 0) ? (fCompOut[1][0] + fCompOut[1][1]) / 2.0 : 0.0;
+            outputBuffers[0][n] = fMid + fSide;
+            outputBuffers[1][n] = fMid - fSide;
         }
-        else if (convertToMono == 1){
-            *pfOutBuffer0++ = fCompMonoMix;                                                         //output mono compressed signal
-            *pfOutBuffer1++ = fCompMonoMix;
+        
+        if (bLimiter){
+            float fAhead[kMaxChannels], fAheadMono = 0.0;                                           //the undelayed bands at this gain - what the
+            for (int x = 0; x < iChannels; x++){                                                    //lookahead will put out, so the limiter sees it first
+                fAhead[x] = (fBand[x][0] * fComp[x][0] * fMakeup[0] + fBand[x][1] * fComp[x][1] * fMakeup[1]) / 2.0;
+                fAheadMono += fAhead[x] / iChannels;
+            }
+            for (int x = 0; x < iChannels; x++){
+                fAhead[x] = (convertToMono == 1) ? fAheadMono : fAhead[x];
+            }
+            if (bMidSide){
+                float fMid = fAhead[0], fSide = (convertToMono == 0) ? fAhead[1] : 0.0;
+                fAhead[0] = fMid + fSide;
+                fAhead[1] = fMid - fSide;
+            }
+            
+            float fPeak = 0.0, fOutPeak = 0.0;
+            for (int x = 0; x < iChannels; x++){
+                float fTruePeak = limiterPeak[x].process(fAhead[x]);
+                fPeak = fTruePeak > fPeak ? fTruePeak : fPeak;
+                float fAbs = fabs(outputBuffers[x][n]);
+                fOutPeak = fAbs > fOutPeak ? fAbs : fOutPeak;
+            }
+            
+            float fLimit = limiter.process(fPeak, fCeiling);
+            if (fOutPeak * fLimit > fCeiling){
+                fLimit = fCeiling / fOutPeak;                                                       //the gain moved inside the lookahead - still never over
+            }
+            for (int x = 0; x < iChannels; x++){
+                outputBuffers[x][n] *= fLimit;
+            }
         }
         
     }
+    
+    inputLoudness.process(inputBuffers, iChannels, numSamples);                                     //K-weighted loudness, a block at a time
+    int iSteps = outputLoudness.process(outputBuffers, iChannels, numSamples);
+    if (bAutoMakeup && inputLoudness.getMomentary() > LoudnessMeter<kMaxChannels>::kMinLoudness){
+        float fDifference = inputLoudness.getMomentary() - outputLoudness.getMomentary();           //the shortest window keeps the loop from overshooting
+        fAutoMakeupDb = jlimit(-(float) kAutoMakeupRange, (float) kAutoMakeupRange, fAutoMakeupDb + 0.05f * iSteps * fDifference);  //closes the gap over a couple of seconds
+    }
+    setParameter(kParam38, outputLoudness.getMomentary());
+    setParameter(kParam39, outputLoudness.getShortTerm());
+    setParameter(kParam40, outputLoudness.getIntegrated());
+    for (int p = 0; p < 3; p++){
+        if (getParameter(kParam4 + p) != fMeterStart[p]){
+            touchParameter(kParam4 + p);                                                            //one refresh a block for the meters the samples moved
+        }
+    }
+    
+    fBandGain[0] = fBlockGain[0];                                                                   //publish once per block for the analysis overlay
+    fBandGain[1] = fBlockGain[1];
+    fBandCrossover = current.fCentreFreq;
 
 }
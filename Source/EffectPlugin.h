@@ -11,6 +11,47 @@
 #include "PluginProcessor.h"
 #include "EffectExtra.h"
 
+enum LINK_MODE
+{
+    LINK_OFF,       // independent detector per channel
+    LINK_MAX,       // one detector on the louder channel
+    LINK_SUM,       // one detector on the channel average
+    LINK_PARTIAL,   // independent detectors pulled towards the louder channel
+};
+
+enum LINK_GROUPS
+{
+    GROUPS_ALL,     // every channel links with every other
+    GROUPS_PAIRS,   // channels link in pairs - 1/2, 3/4, 5/6...
+};
+
+enum { kMaxChannels = 16 };  // channels beyond this are left silent
+
+enum
+{
+    kLimiterFactor = 4,             // true-peak oversampling for the output limiter
+    kLimiterReleaseMs = 50,
+    kAutoMakeupRange = 24,          // dB either way
+};
+
+// Everything process() works out from the parameters, per band where it differs
+struct EffectSettings
+{
+    float fThresh[2], fRatio[2], fMakeupGain[2];
+    float fKneeWidth, fCentreFreq;
+    GainComputer computer[2];   // static curve for each band's mode
+    double fAttackMs, fReleaseMs;
+    double fLpf[5], fHpf[5];    // crossover biquads, as { b0, b1, b2, a1, a2 }
+    double fSampleRate;         // rate the crossover was designed for
+};
+
+// A user transfer curve and its gain table, built together so they're published whole
+struct CompiledCurve
+{
+    TransferCurve curve;        // as set, tidied up
+    GainCurve gain;
+    float fThresh;              // where the curve starts to bend, for auto release
+};
 
 class MyEffect : public Effect
 {
@@ -26,24 +67,77 @@ public:
     void presetLoaded(int iPresetNum, const char *sPresetName);
     void optionChanged(int iOptionMenu, int iItem);
     void buttonPressed(int iButton);
-    void compressAndSendToMeter (float fInput[][2], float fMeterLevel[][2], float fMakeupGain[], float fThreshold[], float fRatio[]);
+    void compressAndSendToMeter (float fInput[][2], float fMeterLevel[][2], float fMakeupGain[], const GainComputer computer[]);
     float linearToDecibel(float parameter);
     float decibelToLinear(float decibel);
-    float delay(float *buffer, float input, float fLookahead);
+    float delay(int iLine, float input, int iDelaySamples);
+    void setLinkGroups(int iGroups);
+    
+    int getNumTransferCurves() { return 2; }
+    void setTransferCurve(int iBand, const TransferCurve& curve);
+    void getTransferCurve(int iBand, TransferCurve& curve);
+    CompiledCurve* compileCurve(const TransferCurve& curve);
+    int getLatencySamples();
+    void prepare(double sampleRate);
+    void transportStarted();
+    int getBandActivity(BandActivity* bands, int maxBands);
+    
+    void cachePreset(int iPresetNum, const float* pfValues);
+    void selectPreset(int iPresetNum);
+    void deriveSettings(const float* pfValues, EffectSettings& settings);
+    void startFade(const EffectSettings& settings);
+    void stepFade();
+    void applyFilterSettings();
+    int getSettingsVersion();
     
 
 private:
     // Declare shared effect variables here
-    float fComp[2][2], fCombinedSignal[2][2], fBand[2][2], fLeftComp[2], fRightComp[2];
-    float fCompType, fMonoPeak, fMonoRms, fCompMonoMix, fTotalCompression, kneeWidth, fLookahead, fSR;
-    float *pfCircularBuffer0, *pfCircularBuffer1;
-    int iBufferSize, iBufferWritePos;
-    double fRelease;
-
-    Peak peak[2];
-    RMS rms[2];
-    LPF lpf[2];
-    HPF hpf[2];
+    // per channel state is [channel][band], band 0 being the high band
+    float fComp[kMaxChannels][2], fCombinedSignal[kMaxChannels][2], fBand[kMaxChannels][2], fKeyBand[kMaxChannels][2], fCompOut[kMaxChannels][2];
+    float fBlockGain[2], fHistorySum[2];
+    Atomic<float> fBandGain[2], fBandCrossover;                 //published once a block, read by the editor's scope thread
+    GainFrame historyFrame;
+    int iHistoryCount;
+    float fCompType, fMonoPeak, fMonoRms, fCompMonoMix, fTotalCompression, fLookahead, fSR;
+    HeapBlock<float> pfDelayLines;                              //one lookahead line per channel and band
+    int iBufferSize, iBufferWritePos, iTruePeakFactor, iGainFactor, iLinkMode, iChannels;
+    int iLinkLeader[kMaxChannels];                              //first channel of each channel's link group
+    bool bGainHighQuality, bGainTable, bCustomCurve;
+    GainCurve gainCurve[2];                                     //tabulated static curve per band, shared by the channels
+    OwnedArray<CompiledCurve> compiledCurves;                   //built on the message thread - replaced ones are freed in prepare()
+    Atomic<CompiledCurve*> activeCurve[2];                      //the user's transfer curve for each band
+    OwnedArray<CompiledCurve> presetCurves;                     //the Curve menu's factory curves, built once
+    const CompiledCurve* pCustomCurve[2];                       //as picked up for this block
+    EnvelopeBank<kMaxChannels> peakEnvelope[2], rmsEnvelope[2];  //attack/release per band, one lane per channel
+    int iEnvelopeMode;
+    bool bAutoRelease;
+    int iDetectorTopology;
+    bool bLimiter;
+    float fCeiling;                                             //limiter ceiling, linear
+    int iLatency;                                               //lookahead, shared by the compressor and limiter
+    bool bAutoMakeup;
+    float fAutoMakeupDb, fAutoMakeup, fAutoMakeupCoeff;         //target, and the gain gliding towards it
+    float fGateOpen[2][kMaxChannels];                           //hysteresis state per band, one lane per channel
+    
+    OwnedArray<EffectSettings> presetSettings;                  //derived once per program, on the message thread
+    OwnedArray<EffectSettings> retiredSettings;                 //replaced, but maybe still being read - freed in prepare()
+    Atomic<EffectSettings*> pendingSettings;                    //program picked since the last block
+    EffectSettings current, fadeFrom, target;
+    int iFadeSamples, iFadeLength, iSettingsVersion;
+
+    Peak peak[kMaxChannels][2], meterPeak[kMaxChannels];
+    TruePeak truePeak[kMaxChannels][2], limiterPeak[kMaxChannels];
+    LookaheadLimiter limiter;
+    LoudnessMeter<kMaxChannels> inputLoudness, outputLoudness;
+    OversampledGain osGain[kMaxChannels][2], osGainOld[kMaxChannels][2];   //old one carries on through a switch's crossfade
+    int iGainFadeSamples;
+    RMS rms[kMaxChannels][2], meterRms[kMaxChannels];
+    Crossover<kMaxChannels, double> crossover, keyCrossover;                //every channel at once - double for mastering,
+    Crossover<kMaxChannels, float> crossoverFloat, keyCrossoverFloat;      //float for tracking (Filter Precision)
+    bool bDoublePrecision;
+    HPF keyFilter[kMaxChannels];
+    float fLastKeyCutoff;                                      //0 while the key HPF isn't running
     
     
 
@@ -0,0 +1,733 @@
+//
+//  PluginAnalysis.cpp
+//  TestEffectAU
+//
+//  Analysis feeds passed from the audio thread to the editor's scopes and meters,
+//  and the scopes that render them on a background thread.
+//
+
+#include "PluginAnalysis.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+//==============================================================================
+AnalysisTap::AnalysisTap (int numChannels_, int capacity)
+: numChannels (numChannels_), fifo (capacity), buffer (numChannels_ * capacity, true)
+{
+}
+
+void AnalysisTap::write (const float* const* channels, int numSamples)
+{
+    const int capacity = fifo.getTotalSize();
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+    
+    for (int c = 0; c < numChannels; c++){
+        float* ring = buffer + c * capacity;
+        if (size1 > 0)
+            FloatVectorOperations::copy (ring + start1, channels[c], size1);
+        if (size2 > 0)
+            FloatVectorOperations::copy (ring + start2, channels[c] + size1, size2);
+    }
+    
+    fifo.finishedWrite (size1 + size2);
+    
+    if (size1 + size2 < numSamples)
+        overflows += numSamples - (size1 + size2);
+}
+
+int AnalysisTap::read (float* const* dest, int maxSamples)
+{
+    const int capacity = fifo.getTotalSize();
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (maxSamples, start1, size1, start2, size2);
+    
+    for (int c = 0; c < numChannels; c++){
+        const float* ring = buffer + c * capacity;
+        if (size1 > 0)
+            FloatVectorOperations::copy (dest[c], ring + start1, size1);
+        if (size2 > 0)
+            FloatVectorOperations::copy (dest[c] + size1, ring + start2, size2);
+    }
+    
+    fifo.finishedRead (size1 + size2);
+    return size1 + size2;
+}
+
+//==============================================================================
+void GainFrame::reset()
+{
+    for (int b = 0; b < kMaxBands; b++){
+        fMin[b] = fMax[b] = fMean[b] = 1.0f;
+    }
+}
+
+void GainFrame::add (const GainFrame& other, int numBands)
+{
+    for (int b = 0; b < numBands; b++){
+        fMin[b] = jmin (fMin[b], other.fMin[b]);
+        fMax[b] = jmax (fMax[b], other.fMax[b]);
+        fMean[b] = 0.5f * (fMean[b] + other.fMean[b]);   // only ever merges equal spans
+    }
+}
+
+//==============================================================================
+GainHistoryTap::GainHistoryTap (int capacity)
+: fifo (capacity), frames (capacity), numBands (0)
+{
+}
+
+void GainHistoryTap::write (const GainFrame& frame)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    
+    if (size1 > 0){
+        frames[start1] = frame;
+        fifo.finishedWrite (1);
+    }
+    else{
+        ++overflows;
+    }
+}
+
+int GainHistoryTap::read (GainFrame* dest, int maxFrames)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (maxFrames, start1, size1, start2, size2);
+    
+    for (int i = 0; i < size1; i++)
+        dest[i] = frames[start1 + i];
+    for (int i = 0; i < size2; i++)
+        dest[size1 + i] = frames[start2 + i];
+    
+    fifo.finishedRead (size1 + size2);
+    return size1 + size2;
+}
+
+//==============================================================================
+GainPyramid::GainPyramid (int levelSizeLog2, int numLevels_)
+: levelSize (1 << levelSizeLog2), numLevels (jmax (1, numLevels_)), numFrames (0),
+  frames (numLevels * levelSize)
+{
+}
+
+int64 GainPyramid::getFirstFrame() const
+{
+    const int top = numLevels - 1;
+    return jmax ((int64)0, ((numFrames >> top) - levelSize) << top);
+}
+
+void GainPyramid::clear()
+{
+    numFrames = 0;
+}
+
+void GainPyramid::add (const GainFrame& frame, int numBands)
+{
+    // frame n of level k covers level 0 frames [n << k, (n + 1) << k)
+    int64 n = numFrames++;
+    getFrame (0, n) = frame;
+    
+    // each completed pair is merged into the level above
+    for (int k = 1; k < numLevels && (n & 1); k++){
+        GainFrame merged = getFrame (k - 1, n - 1);
+        merged.add (getFrame (k - 1, n), numBands);
+        
+        n >>= 1;
+        getFrame (k, n) = merged;
+    }
+}
+
+bool GainPyramid::getRange (int64 start, int64 end, int numBands, GainFrame& result) const
+{
+    start = jmax (start, getFirstFrame());
+    end = jmin (end, numFrames);
+    if (start >= end)
+        return false;
+    
+    // cover the range with the largest aligned frames that fit - O(log n) frames - moving
+    // up a level wherever the finer one no longer reaches back that far
+    float fSum[GainFrame::kMaxBands] = { 0 };
+    int64 covered = 0;
+    
+    for (int64 n = start; n < end;){
+        int k = 0;
+        while (k + 1 < numLevels && (n & (((int64)2 << k) - 1)) == 0 && n + ((int64)2 << k) <= end)
+            k++;
+        while (k + 1 < numLevels && ! isHeld (k, n >> k))
+            k++;
+        
+        const int64 next = ((n >> k) + 1) << k;
+        if (isHeld (k, n >> k)){
+            const GainFrame& frame = getFrame (k, n >> k);
+            const int64 count = jmin (next, end) - n;
+            for (int b = 0; b < numBands; b++){
+                result.fMin[b] = covered == 0 ? frame.fMin[b] : jmin (result.fMin[b], frame.fMin[b]);
+                result.fMax[b] = covered == 0 ? frame.fMax[b] : jmax (result.fMax[b], frame.fMax[b]);
+                fSum[b] += frame.fMean[b] * (float)count;
+            }
+            covered += count;
+        }
+        n = next;
+    }
+    
+    if (covered == 0)
+        return false;
+    
+    for (int b = 0; b < numBands; b++)
+        result.fMean[b] = fSum[b] / (float)covered;
+    
+    return true;
+}
+
+//==============================================================================
+namespace
+{
+    struct WindowTable
+    {
+        int size;
+        float gain;
+        HeapBlock<float> data;
+    };
+    
+    CriticalSection windowLock;
+    OwnedArray<WindowTable> windowTables;
+    
+    const float kMinPower = 1.0e-20f;     // -200dB, keeps log() away from zero
+    
+    //==============================================================================
+    // 10*log10(re^2 + im^2) * scale for a run of bins. The log is a polynomial fit
+    // on the float mantissa, good to about 0.001dB - plenty for a display.
+    void powerToDecibels (float* dB, const float* re, const float* im, int n, float fScale)
+    {
+        const float k10Log2 = 3.0103f;
+        const float kOffset = 10.0f * log10f (fScale);
+        int i = 0;
+        
+#if JUCE_INTEL
+        const __m128 vMin = _mm_set1_ps (kMinPower);
+        const __m128i vMask = _mm_set1_epi32 (0x007fffff);
+        const __m128i vOne = _mm_set1_epi32 (0x3f800000);
+        const __m128i vBias = _mm_set1_epi32 (127);
+        
+        for (; i <= n - 4; i += 4){
+            const __m128 r = _mm_loadu_ps (re + i);
+            const __m128 m = _mm_loadu_ps (im + i);
+            const __m128 p = _mm_max_ps (_mm_add_ps (_mm_mul_ps (r, r), _mm_mul_ps (m, m)), vMin);
+            
+            const __m128i bits = _mm_castps_si128 (p);
+            const __m128 e = _mm_cvtepi32_ps (_mm_sub_epi32 (_mm_srli_epi32 (bits, 23), vBias));
+            const __m128 x = _mm_castsi128_ps (_mm_or_si128 (_mm_and_si128 (bits, vMask), vOne));
+            
+            __m128 poly = _mm_set1_ps (-0.07915037f);
+            poly = _mm_add_ps (_mm_mul_ps (poly, x), _mm_set1_ps (0.62881573f));
+            poly = _mm_add_ps (_mm_mul_ps (poly, x), _mm_set1_ps (-2.0810602f));
+            poly = _mm_add_ps (_mm_mul_ps (poly, x), _mm_set1_ps (4.0283728f));
+            poly = _mm_add_ps (_mm_mul_ps (poly, x), _mm_set1_ps (-2.4967738f));
+            
+            const __m128 log2p = _mm_add_ps (e, poly);
+            _mm_storeu_ps (dB + i, _mm_add_ps (_mm_mul_ps (log2p, _mm_set1_ps (k10Log2)), _mm_set1_ps (kOffset)));
+        }
+#endif
+        for (; i < n; i++)
+            dB[i] = 10.0f * log10f (jmax (re[i] * re[i] + im[i] * im[i], kMinPower)) + kOffset;
+    }
+    
+    // one-pole smoothing in dB with separate rise and fall coefficients
+    void applyBallistics (float* level, const float* target, int n, float fAttack, float fRelease)
+    {
+        int i = 0;
+        
+#if JUCE_INTEL
+        const __m128 vAttack = _mm_set1_ps (1.0f - fAttack);
+        const __m128 vRelease = _mm_set1_ps (1.0f - fRelease);
+        
+        for (; i <= n - 4; i += 4){
+            const __m128 l = _mm_loadu_ps (level + i);
+            const __m128 d = _mm_sub_ps (_mm_loadu_ps (target + i), l);
+            const __m128 rising = _mm_cmpgt_ps (d, _mm_setzero_ps());
+            const __m128 k = _mm_or_ps (_mm_and_ps (rising, vAttack), _mm_andnot_ps (rising, vRelease));
+            _mm_storeu_ps (level + i, _mm_add_ps (l, _mm_mul_ps (d, k)));
+        }
+#endif
+        for (; i < n; i++){
+            const float d = target[i] - level[i];
+            level[i] += d * (1.0f - (d > 0.0f ? fAttack : fRelease));
+        }
+    }
+}
+
+//==============================================================================
+StftAnalyser::StftAnalyser (int fftSizeLog2, int numChannels_)
+: fft (fftSizeLog2), fftSize (1 << fftSizeLog2), numChannels (numChannels_), hopSize (fftSize / 2), fill (0),
+  sampleRate (44100.0), attackMs (10.0), releaseMs (300.0)
+{
+    float gain;
+    window = getWindow (fftSize, gain);
+    
+    // normalise so a full scale sine reads 0dB (vDSP's real FFT output is scaled by 2)
+#if (JUCE_MAC || JUCE_IOS) && ! DROWAUDIO_USE_FFTREAL
+    const float fNorm = 1.0f / (fftSize * gain);
+#else
+    const float fNorm = 2.0f / (fftSize * gain);
+#endif
+    fScale = fNorm * fNorm;
+    
+    history.allocate (numChannels * fftSize, true);
+    frame.allocate (fftSize, true);
+    frameLevels.allocate (numChannels * getNumBins(), true);
+    smoothedLevels.allocate (numChannels * getNumBins(), true);
+    
+    FloatVectorOperations::fill (smoothedLevels, -200.0f, numChannels * getNumBins());
+    updateCoefficients();
+}
+
+const float* StftAnalyser::getWindow (int size, float& gain)
+{
+    const ScopedLock sl (windowLock);
+    
+    for (int i = 0; i < windowTables.size(); i++){
+        if (windowTables[i]->size == size){
+            gain = windowTables[i]->gain;
+            return windowTables[i]->data;
+        }
+    }
+    
+    WindowTable* table = windowTables.add (new WindowTable());
+    table->size = size;
+    table->data.allocate (size, false);
+    
+    double sum = 0.0;
+    for (int i = 0; i < size; i++){
+        table->data[i] = (float)(0.5 - 0.5 * cos (2.0 * double_Pi * i / size));
+        sum += table->data[i];
+    }
+    table->gain = (float)(sum / size);
+    
+    gain = table->gain;
+    return table->data;
+}
+
+void StftAnalyser::setOverlap (int hopsPerFrame)
+{
+    jassert (hopsPerFrame == 2 || hopsPerFrame == 4 || hopsPerFrame == 8);
+    
+    hopSize = fftSize / jlimit (2, 8, hopsPerFrame);
+    fill = jmin (fill, fftSize - 1);
+    updateCoefficients();
+}
+
+void StftAnalyser::setSampleRate (double newSampleRate)
+{
+    if (newSampleRate > 0.0 && newSampleRate != sampleRate){
+        sampleRate = newSampleRate;
+        updateCoefficients();
+    }
+}
+
+void StftAnalyser::setBallistics (double newAttackMs, double newReleaseMs)
+{
+    attackMs = newAttackMs;
+    releaseMs = newReleaseMs;
+    updateCoefficients();
+}
+
+void StftAnalyser::updateCoefficients()
+{
+    // the smoothing runs once per hop, so the time constants are in hops
+    const double hopMs = 1000.0 * hopSize / sampleRate;
+    fAttack = attackMs > 0.0 ? (float)exp (-hopMs / attackMs) : 0.0f;
+    fRelease = releaseMs > 0.0 ? (float)exp (-hopMs / releaseMs) : 0.0f;
+}
+
+int StftAnalyser::getBinForFrequency (double hz) const
+{
+    return jlimit (0, getNumBins() - 1, roundToInt (hz * fftSize / sampleRate));
+}
+
+int StftAnalyser::push (const float* const* samples, int numSamples, bool& frameDone)
+{
+    const int n = jmin (numSamples, fftSize - fill);
+    for (int c = 0; c < numChannels; c++)
+        FloatVectorOperations::copy (history + c * fftSize + fill, samples[c], n);
+    fill += n;
+    
+    frameDone = fill == fftSize;
+    if (frameDone){
+        analyseFrame();
+        
+        // keep the overlapping part for the next frame
+        for (int c = 0; c < numChannels; c++){
+            float* pfHistory = history + c * fftSize;
+            memmove (pfHistory, pfHistory + hopSize, (fftSize - hopSize) * sizeof (float));
+        }
+        fill = fftSize - hopSize;
+    }
+    
+    return n;
+}
+
+void StftAnalyser::analyseFrame()
+{
+    const int numBins = getNumBins();
+    
+    for (int c = 0; c < numChannels; c++){
+        FloatVectorOperations::copy (frame, history + c * fftSize, fftSize);
+        FloatVectorOperations::multiply (frame, window, fftSize);
+        fft.performFFT (frame);
+        
+        // DC goes in with its (zero) imaginary part; the packed Nyquist term is ignored
+        const drow::SplitComplex& bins = fft.getFFTBuffer();
+        const float fZero = 0.0f;
+        float* pfLevels = frameLevels + c * numBins;
+        powerToDecibels (pfLevels, bins.realp, &fZero, 1, fScale);
+        powerToDecibels (pfLevels + 1, bins.realp + 1, bins.imagp + 1, numBins - 1, fScale);
+        
+        applyBallistics (smoothedLevels + c * numBins, pfLevels, numBins, fAttack, fRelease);
+    }
+}
+
+//==============================================================================
+AnalysisScope::AnalysisScope (Mode mode_, int fftSizeLog2)
+: mode (mode_), stft (fftSizeLog2, mode_ == SPECTRUM ? kNumAnalysisChannels : 1),
+  logFrequency (false), sampleRate (44100.0), numBands (0),
+  traceCount (0), traceMin (1.0f), traceMax (-1.0f), lastMin (0.0f), lastMax (0.0f), width (1), height (1)
+{
+    setOpaque (true);
+    
+    // 50% overlap for both: the sonogram scrolls a pixel per frame, and the spectrum
+    // analyses input and output, so this keeps it at the old single-channel FFT rate
+    stft.setOverlap (2);
+    
+    canvas = Image (Image::RGB, 1, 1, true, SoftwareImageType());
+    front = canvas.createCopy();
+}
+
+void AnalysisScope::resized()
+{
+    // the scope thread picks up the new size on its next frame
+    width = jmax (1, getWidth());
+    height = jmax (1, getHeight());
+}
+
+void AnalysisScope::paint (Graphics& g)
+{
+    const ScopedLock sl (frontLock);
+    
+    if (front.getWidth() != getWidth() || front.getHeight() != getHeight())
+        g.fillAll (Colours::black);
+    
+    g.drawImageAt (front, 0, 0, false);
+}
+
+void AnalysisScope::timerCallback()
+{
+    if (published.compareAndSetBool (0, 1))
+        repaint();
+}
+
+//==============================================================================
+void AnalysisScope::setBandActivity (const BandActivity* newBands, int newNumBands)
+{
+    numBands = jmin ((int)kMaxBands, newNumBands);
+    for (int b = 0; b < numBands; b++)
+        bands[b] = newBands[b];
+}
+
+void AnalysisScope::processSamples (const float* const* samples, int numSamples)
+{
+    if (canvas.getWidth() != width.get() || canvas.getHeight() != height.get())
+        canvas = canvas.rescaled (width.get(), height.get());
+    
+    if (mode == OSCILLOSCOPE){
+        if (renderTrace (samples[ANALYSIS_OUTPUT], numSamples))
+            publish();
+        return;
+    }
+    
+    const float* pfChannels[kNumAnalysisChannels];
+    for (int c = 0; c < stft.getNumChannels(); c++)
+        pfChannels[c] = samples[c];
+    
+    stft.setSampleRate (sampleRate.get());
+    
+    bool bNewFrame = false;
+    
+    while (numSamples > 0){
+        bool bFrameDone;
+        const int n = stft.push (pfChannels, numSamples, bFrameDone);
+        for (int c = 0; c < stft.getNumChannels(); c++)
+            pfChannels[c] += n;
+        numSamples -= n;
+        
+        if (bFrameDone){
+            if (mode == SONOGRAM)
+                renderSonogramLine();
+            bNewFrame = true;
+        }
+    }
+    
+    if (bNewFrame){
+        if (mode == SPECTRUM)
+            renderSpectrum();
+        publish();
+    }
+}
+
+float AnalysisScope::getPosition (double fBins, float size) const
+{
+    // fBins counts bins from DC; the log scale maps 0-nyquist over 1-40
+    const double fProportion = jlimit (0.0, 1.0, fBins / stft.getNumBins());
+    return logFrequency ? (float)(log10 (1 + 39 * fProportion) / log10 (40.0) * size)
+                        : (float)(fProportion * size);
+}
+
+float AnalysisScope::getBinPosition (int bin, float size) const
+{
+    return getPosition (bin + 1.0, size);
+}
+
+float AnalysisScope::getFrequencyPosition (double hz, float size) const
+{
+    return getPosition (hz * stft.getFFTSize() / stft.getSampleRate(), size);
+}
+
+void AnalysisScope::renderSpectrum()
+{
+    Graphics g (canvas);
+    const int w = canvas.getWidth();
+    const int h = canvas.getHeight();
+    
+    g.fillAll (Colours::black);
+    
+    // input behind, output on top
+    for (int c = stft.getNumChannels() - 1; c >= 0; c--){
+        g.setColour (c == ANALYSIS_OUTPUT ? Colours::white : Colours::grey);
+        
+        const float* data = stft.getSmoothedLevels (c);
+        const int n = stft.getNumBins();
+        float y2, y1 = jlimit (0.0f, 1.0f, 1 + data[0] / 100.0f);
+        float x2, x1 = 0;
+        
+        for (int i = 0; i < n; ++i){
+            y2 = jlimit (0.0f, 1.0f, 1 + data[i] / 100.0f);
+            x2 = getBinPosition (i, (float)w);
+            g.drawLine (x1, h - h * y1, x2, h - h * y2);
+            y1 = y2;
+            x1 = x2;
+        }
+    }
+    
+    renderBandActivity (g, w, h);
+}
+
+void AnalysisScope::renderBandActivity (Graphics& g, int w, int h)
+{
+    // gain reduction hangs down from the top of each band's range, 24dB = half height
+    const float fRange = 24.0f;
+    g.setFont (10.0f);
+    
+    for (int b = 0; b < numBands; b++){
+        const float x1 = getFrequencyPosition (bands[b].fLowHz, (float)w);
+        const float x2 = getFrequencyPosition (bands[b].fHighHz, (float)w);
+        const float fReduction = -Decibels::gainToDecibels (bands[b].fGain, -fRange);
+        const float fDepth = jlimit (0.0f, 1.0f, fReduction / fRange) * h * 0.5f;
+        
+        g.setColour (Colours::red.withAlpha (0.3f));
+        g.fillRect (x1, 0.0f, x2 - x1, fDepth);
+        g.setColour (Colours::red);
+        g.drawHorizontalLine ((int)fDepth, x1, x2);
+        g.drawText ("-" + String (fReduction, 1) + " dB", (int)x1, (int)fDepth + 2, (int)(x2 - x1), 12, Justification::centred, false);
+    }
+}
+
+void AnalysisScope::renderSonogramLine()
+{
+    const int w = canvas.getWidth();
+    const int h = canvas.getHeight();
+    
+    // scroll one pixel left and draw the newest frame in the last column
+    canvas.moveImageSection (0, 0, 1, 0, w - 1, h);
+    
+    Graphics g (canvas);
+    const float* data = stft.getFrameLevels();
+    const int n = stft.getNumBins();
+    const float x = (float)(w - 1);
+    float y2, y1 = 0;
+    
+    for (int i = 0; i < n; ++i){
+        y2 = getBinPosition (i, (float)h);
+        g.setColour (Colour::greyLevel (jlimit (0.0f, 1.0f, 1 + data[i] / 100.0f)));
+        g.fillRect (x, h - y2, 1.0f, y2 - y1);
+        y1 = y2;
+    }
+}
+
+bool AnalysisScope::renderTrace (const float* samples, int numSamples)
+{
+    // a column per kSamplesPerColumn samples, scrolled in a batch at a time so the
+    // canvas only moves once per batch rather than once per column
+    enum { kSamplesPerColumn = 2, kMaxColumns = 256 };
+    float fMin[kMaxColumns], fMax[kMaxColumns];
+    
+    const int w = canvas.getWidth();
+    const int h = canvas.getHeight();
+    const float fHalfHeight = h * 0.5f;
+    bool bDrawn = false;
+    int n = 0;
+    
+    while (n < numSamples){
+        int numColumns = 0;
+        for (; n < numSamples && numColumns < kMaxColumns; ++n){
+            traceMin = jmin (traceMin, samples[n]);
+            traceMax = jmax (traceMax, samples[n]);
+            if (++traceCount == kSamplesPerColumn){
+                fMin[numColumns] = traceMin;
+                fMax[numColumns] = traceMax;
+                numColumns++;
+                traceCount = 0;
+                traceMin = 1.0f;
+                traceMax = -1.0f;
+            }
+        }
+        if (numColumns == 0)
+            break;
+        
+        const int numShown = jmin (numColumns, w);
+        canvas.moveImageSection (0, 0, numShown, 0, w - numShown, h);
+        
+        Graphics g (canvas);
+        g.setColour (Colours::black);
+        g.fillRect (w - numShown, 0, numShown, h);
+        g.setColour (Colours::white);
+        
+        for (int c = numColumns - numShown; c < numColumns; ++c){
+            // stretch each column to meet the last, so steep edges stay joined up
+            const float fLow = jmin (fMin[c], lastMax);
+            const float fHigh = jmax (fMax[c], lastMin);
+            lastMin = fLow;
+            lastMax = fHigh;
+            
+            const float x = (float)(w - numColumns + c);
+            g.drawLine (x, fHalfHeight * (1.0f - fHigh), x, fHalfHeight * (1.0f - fLow));
+        }
+        bDrawn = true;
+    }
+    return bDrawn;
+}
+
+void AnalysisScope::publish()
+{
+    // copy rather than swap, so the sonogram canvas keeps its history
+    const ScopedLock sl (frontLock);
+    
+    if (front.getWidth() != canvas.getWidth() || front.getHeight() != canvas.getHeight())
+        front = Image (Image::RGB, canvas.getWidth(), canvas.getHeight(), false, SoftwareImageType());
+    
+    Graphics g (front);
+    g.drawImageAt (canvas, 0, 0, false);
+    
+    published = 1;
+}
+
+//==============================================================================
+namespace
+{
+    const int kHistoryReadBlock = 256;
+    const float kHistoryRange = 24.0f;     // dB of gain reduction over the full height
+    
+    const Colour kBandColours[GainFrame::kMaxBands] = {
+        Colours::deepskyblue, Colours::orange, Colours::limegreen, Colours::violet
+    };
+}
+
+GainHistoryView::GainHistoryView()
+: readBlock (kHistoryReadBlock), numBands (0), sampleRate (44100.0), visibleSeconds (10.0)
+{
+    setOpaque (true);
+}
+
+void GainHistoryView::update (GainHistoryTap& tap)
+{
+    numBands = tap.getNumBands();
+    
+    int numRead, total = 0;
+    while ((numRead = tap.read (readBlock, kHistoryReadBlock)) > 0){
+        for (int i = 0; i < numRead; i++)
+            pyramid.add (readBlock[i], numBands);
+        total += numRead;
+    }
+    
+    if (total > 0 && isShowing())
+        repaint();
+}
+
+void GainHistoryView::mouseWheelMove (const MouseEvent&, const MouseWheelDetails& wheel)
+{
+    // from two seconds up to everything the pyramid holds
+    const double maxSeconds = (pyramid.getNumFrames() - pyramid.getFirstFrame()) * getSecondsPerFrame();
+    visibleSeconds = jlimit (2.0, jmax (2.0, maxSeconds), visibleSeconds * pow (2.0, -wheel.deltaY * 2.0));
+    repaint();
+}
+
+void GainHistoryView::paint (Graphics& g)
+{
+    const int w = getWidth();
+    const int h = getHeight();
+    
+    g.fillAll (Colours::black);
+    
+    // a line every 6dB of gain reduction
+    g.setColour (Colours::darkgrey);
+    g.setFont (10.0f);
+    for (int dB = 6; dB < kHistoryRange; dB += 6){
+        const int y = (int)(h * dB / kHistoryRange);
+        g.drawHorizontalLine (y, 0.0f, (float)w);
+        g.drawText ("-" + String (dB) + " dB", 2, y - 12, 40, 12, Justification::left, false);
+    }
+    g.drawText (String (visibleSeconds, 1) + " s", w - 50, 2, 48, 12, Justification::right, false);
+    
+    if (numBands == 0 || pyramid.getNumFrames() == 0)
+        return;
+    
+    // newest history at the right edge, one pyramid query per column
+    const double framesPerPixel = visibleSeconds / getSecondsPerFrame() / w;
+    const int64 end = pyramid.getNumFrames();
+    
+    Path mean[GainFrame::kMaxBands];
+    bool bStarted[GainFrame::kMaxBands] = { false };
+    
+    for (int x = 0; x < w; x++){
+        const int64 from = end - (int64)((w - x) * framesPerPixel);
+        const int64 to = jmax (from + 1, end - (int64)((w - x - 1) * framesPerPixel));
+        
+        GainFrame frame;
+        if (!pyramid.getRange (from, to, numBands, frame))
+            continue;
+        
+        for (int b = 0; b < numBands; b++){
+            const float yMin = h * jlimit (0.0f, 1.0f, -Decibels::gainToDecibels (frame.fMax[b], -kHistoryRange) / kHistoryRange);
+            const float yMax = h * jlimit (0.0f, 1.0f, -Decibels::gainToDecibels (frame.fMin[b], -kHistoryRange) / kHistoryRange);
+            const float yMean = h * jlimit (0.0f, 1.0f, -Decibels::gainToDecibels (frame.fMean[b], -kHistoryRange) / kHistoryRange);
+            
+            g.setColour (kBandColours[b].withAlpha (0.35f));
+            g.drawVerticalLine (x, yMin, jmax (yMin + 1.0f, yMax));
+            
+            if (bStarted[b]){
+                mean[b].lineTo ((float)x, yMean);
+            }
+            else{
+                mean[b].startNewSubPath ((float)x, yMean);
+                bStarted[b] = true;
+            }
+        }
+    }
+    
+    for (int b = 0; b < numBands; b++){
+        g.setColour (kBandColours[b]);
+        g.strokePath (mean[b], PathStrokeType (1.0f));
+    }
+}
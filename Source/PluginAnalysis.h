@@ -0,0 +1,334 @@
+//
+//  PluginAnalysis.h
+//  TestEffectAU
+//
+//  Analysis feeds passed from the audio thread to the editor's scopes and meters,
+//  and the scopes that render them on a background thread.
+//
+
+#ifndef __PluginAnalysis_h__
+#define __PluginAnalysis_h__
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// channels captured by the processor's analysis tap
+enum ANALYSIS_CHANNEL
+{
+    ANALYSIS_OUTPUT,    // mono mix of the processed output
+    ANALYSIS_INPUT,     // mono mix of the input, before compression
+    kNumAnalysisChannels
+};
+
+// gain applied to one band over the last processed block
+struct BandActivity
+{
+    float fLowHz, fHighHz;  // frequency range covered by the band
+    float fGain;            // lowest gain (linear) applied in the block
+};
+
+//==============================================================================
+/** A wait-free single-producer/single-consumer multichannel sample FIFO.
+ 
+    The audio thread calls write() and the editor's scope thread calls read();
+    neither side ever blocks or allocates. All channels share one read/write
+    position, so they stay sample-aligned. If the reader falls behind, the newest
+    samples are dropped and counted, rather than the writer waiting for space.
+    The editor switches the tap on with setActive() only while a scope is visible.
+*/
+class AnalysisTap
+{
+public:
+    AnalysisTap (int numChannels = 1, int capacity = 32768);
+    
+    /** Enables or disables the feed (message thread). */
+    void setActive (bool shouldBeActive)            { active = shouldBeActive ? 1 : 0; }
+    
+    /** True while a consumer wants data (audio thread). */
+    bool isActive() const                           { return active.get() != 0; }
+    
+    int getNumChannels() const                      { return numChannels; }
+    
+    /** Pushes samples to every channel, dropping whatever doesn't fit (audio thread). */
+    void write (const float* const* channels, int numSamples);
+    
+    /** Pops up to maxSamples per channel, returning the number read (scope thread). */
+    int read (float* const* dest, int maxSamples);
+    
+    /** Returns the number of samples waiting to be read. */
+    int getNumReady() const                         { return fifo.getNumReady(); }
+    
+    /** Returns the number of samples dropped since the last call. */
+    int getAndResetOverflowCount()                  { return overflows.exchange (0); }
+    
+private:
+    const int numChannels;
+    AbstractFifo fifo;
+    HeapBlock<float> buffer;    // numChannels consecutive rings of fifo.getTotalSize()
+    Atomic<int> active, overflows;
+    
+    JUCE_DECLARE_NON_COPYABLE (AnalysisTap)
+};
+
+//==============================================================================
+// gain statistics of each band over one history hop
+struct GainFrame
+{
+    enum { kMaxBands = 4 };
+    float fMin[kMaxBands], fMax[kMaxBands], fMean[kMaxBands];   // linear gain
+    
+    void reset();
+    void add (const GainFrame& other, int numBands);             // merge another frame into this one
+};
+
+//==============================================================================
+/** A wait-free ring of gain frames from the audio thread to the history view.
+ 
+    The effect writes one frame every kHopSamples while the tap is active; the
+    editor drains it on its timer. As with AnalysisTap, frames that don't fit
+    are dropped and counted.
+*/
+class GainHistoryTap
+{
+public:
+    enum { kHopSamples = 256 };
+    
+    GainHistoryTap (int capacity = 4096);
+    
+    void setActive (bool shouldBeActive)            { active = shouldBeActive ? 1 : 0; }
+    bool isActive() const                           { return active.get() != 0; }
+    
+    /** Number of bands in each frame, set by the effect. */
+    void setNumBands (int newNumBands)              { numBands = jmin ((int)GainFrame::kMaxBands, newNumBands); }
+    int getNumBands() const                         { return numBands.get(); }
+    
+    /** Pushes one frame (audio thread). */
+    void write (const GainFrame& frame);
+    
+    /** Pops up to maxFrames, returning the number read (message thread). */
+    int read (GainFrame* dest, int maxFrames);
+    
+    int getAndResetOverflowCount()                  { return overflows.exchange (0); }
+    
+private:
+    AbstractFifo fifo;
+    HeapBlock<GainFrame> frames;
+    Atomic<int> active, overflows, numBands;
+    
+    JUCE_DECLARE_NON_COPYABLE (GainHistoryTap)
+};
+
+//==============================================================================
+/** Gain history kept at several resolutions.
+ 
+    Level 0 holds one frame per hop; each level above merges pairs of frames from
+    the level below. Every level keeps the same number of frames - more than the
+    view has pixel columns - so each reaches twice as far back as the one below,
+    and the coarsest sets how much history there is. A range is summarised from a
+    few frames of the finest level that still holds it, so the history view's cost
+    depends on its width in pixels, not on how much history is on screen, and the
+    memory on the number of levels rather than on the span.
+*/
+class GainPyramid
+{
+public:
+    GainPyramid (int levelSizeLog2 = 11, int numLevels = 6);
+    
+    void clear();
+    void add (const GainFrame& frame, int numBands);
+    
+    /** Total number of frames added (the newest is getNumFrames() - 1). */
+    int64 getNumFrames() const                      { return numFrames; }
+    
+    /** Oldest frame still held. */
+    int64 getFirstFrame() const;
+    
+    /** Merges frames [start, end) into result, returning false if none are held. */
+    bool getRange (int64 start, int64 end, int numBands, GainFrame& result) const;
+    
+private:
+    // frame n of level k, with each level stored as a ring of levelSize frames
+    GainFrame& getFrame (int k, int64 n) const
+    {
+        return frames[k * levelSize + (int)(n & (levelSize - 1))];
+    }
+    
+    // true if level k has finished frame n and not yet overwritten it
+    bool isHeld (int k, int64 n) const
+    {
+        return n < (numFrames >> k) && n >= (numFrames >> k) - levelSize;
+    }
+    
+    const int levelSize, numLevels;
+    int64 numFrames;
+    HeapBlock<GainFrame> frames;                // every level, back to back
+    
+    JUCE_DECLARE_NON_COPYABLE (GainPyramid)
+};
+
+//==============================================================================
+/** Overlapped short-time Fourier analysis for the scopes.
+ 
+    Samples are pushed in any block size; every hop samples a Hann-windowed frame
+    of the last fftSize samples is transformed and its per-bin levels (in dB) are
+    computed. Alongside the raw frame, a smoothed spectrum is kept with separate
+    attack and release time constants, so the ballistics don't depend on the hop
+    size or on how often the display refreshes.
+ 
+    Several sample-aligned channels can be analysed in the same pass, sharing the
+    window and the FFT set-up. Window tables are cached by size and shared between
+    all analysers.
+*/
+class StftAnalyser
+{
+public:
+    StftAnalyser (int fftSizeLog2, int numChannels = 1);
+    
+    /** Sets the hop to fftSize / hopsPerFrame (2, 4 or 8 = 50%, 75% or 87.5% overlap). */
+    void setOverlap (int hopsPerFrame);
+    void setSampleRate (double newSampleRate);
+    void setBallistics (double attackMs, double releaseMs);
+    
+    /** Consumes samples (one pointer per channel) up to the end of the next frame,
+        returning the number used. If a frame was completed, frameDone is set and
+        the levels are updated. */
+    int push (const float* const* samples, int numSamples, bool& frameDone);
+    
+    int getNumChannels() const                      { return numChannels; }
+    int getFFTSize() const                          { return fftSize; }
+    int getNumBins() const                          { return fftSize / 2; }
+    int getHopSize() const                          { return hopSize; }
+    double getSampleRate() const                    { return sampleRate; }
+    
+    /** Returns the bin nearest to a frequency. */
+    int getBinForFrequency (double hz) const;
+    
+    /** Per-bin levels of the latest frame, in dB. */
+    const float* getFrameLevels (int channel = 0) const     { return frameLevels + channel * getNumBins(); }
+    
+    /** Per-bin levels after the attack/release ballistics, in dB. */
+    const float* getSmoothedLevels (int channel = 0) const  { return smoothedLevels + channel * getNumBins(); }
+    
+    /** Returns a shared Hann window of the given size, and its coherent gain. */
+    static const float* getWindow (int size, float& gain);
+    
+private:
+    void analyseFrame();
+    void updateCoefficients();
+    
+    drow::FFTOperation fft;
+    const int fftSize, numChannels;
+    int hopSize, fill;
+    double sampleRate, attackMs, releaseMs;
+    float fAttack, fRelease, fScale;
+    const float* window;
+    HeapBlock<float> history, frame, frameLevels, smoothedLevels;   // one run per channel, except frame
+    
+    JUCE_DECLARE_NON_COPYABLE (StftAnalyser)
+};
+
+//==============================================================================
+/** A spectrum, sonogram or oscilloscope view whose analysis and drawing run off
+    the message thread.
+ 
+    The editor's scope thread calls processSamples(), which runs the STFT,
+    draws into a private canvas and then publishes it into the front image.
+    paint() only blits the front image, and timerCallback() repaints when the
+    worker has published something new.
+ 
+    The spectrum takes the tap's output and input channels, and draws the input
+    spectrum behind the output with the gain reduction of each band on top.
+    The oscilloscope skips the STFT and scrolls the output's min/max trace.
+*/
+class AnalysisScope : public Component
+{
+public:
+    enum Mode { SPECTRUM, SONOGRAM, OSCILLOSCOPE };
+    
+    AnalysisScope (Mode mode, int fftSizeLog2);
+    
+    void setLogFrequencyDisplay (bool shouldDisplayLog)   { logFrequency = shouldDisplayLog; }
+    
+    /** Returns the analyser, e.g. to change the overlap or ballistics. */
+    StftAnalyser& getAnalyser()                           { return stft; }
+    
+    /** Passes on the processor's sample rate (message thread). */
+    void setSampleRate (double newSampleRate)             { sampleRate = newSampleRate; }
+    
+    /** Sets the band gains drawn over the spectrum (scope thread). */
+    void setBandActivity (const BandActivity* bands, int numBands);
+    
+    /** Analyses and renders a block of samples, one pointer per tap channel (scope thread). */
+    void processSamples (const float* const* samples, int numSamples);
+    
+    /** Repaints if a new image has been published (message thread). */
+    void timerCallback();
+    
+    /** @internal */
+    void paint (Graphics& g);
+    /** @internal */
+    void resized();
+    
+private:
+    void renderSpectrum();
+    void renderBandActivity (Graphics& g, int w, int h);
+    void renderSonogramLine();
+    bool renderTrace (const float* samples, int numSamples);
+    void publish();
+    float getPosition (double fBins, float size) const;
+    float getBinPosition (int bin, float size) const;
+    float getFrequencyPosition (double hz, float size) const;
+    
+    const Mode mode;
+    StftAnalyser stft;
+    bool logFrequency;
+    Atomic<double> sampleRate;  // set by the message thread, picked up by the scope thread
+    
+    enum { kMaxBands = 8 };
+    BandActivity bands[kMaxBands];
+    int numBands;
+    
+    int traceCount;             // oscilloscope column in progress, and the last one drawn
+    float traceMin, traceMax, lastMin, lastMax;
+    
+    Image canvas;               // drawn by the scope thread only
+    Image front;                // last published frame, blitted by paint()
+    CriticalSection frontLock;
+    Atomic<int> width, height, published;
+    
+    JUCE_DECLARE_NON_COPYABLE (AnalysisScope)
+};
+
+//==============================================================================
+/** Scrolling gain reduction history for each band.
+ 
+    Each pixel column shows the range (min to max) of a band's gain reduction as
+    a bar, with its mean as a line, over the stretch of time it covers. The mouse
+    wheel zooms from a couple of seconds to the whole history.
+*/
+class GainHistoryView : public Component
+{
+public:
+    GainHistoryView();
+    
+    void setSampleRate (double newSampleRate)       { sampleRate = newSampleRate; }
+    
+    /** Moves new frames from the tap into the history, repainting if visible (message thread). */
+    void update (GainHistoryTap& tap);
+    
+    /** @internal */
+    void paint (Graphics& g);
+    /** @internal */
+    void mouseWheelMove (const MouseEvent& e, const MouseWheelDetails& wheel);
+    
+private:
+    double getSecondsPerFrame() const               { return GainHistoryTap::kHopSamples / sampleRate; }
+    
+    GainPyramid pyramid;
+    HeapBlock<GainFrame> readBlock;
+    int numBands;
+    double sampleRate, visibleSeconds;
+    
+    JUCE_DECLARE_NON_COPYABLE (GainHistoryView)
+};
+
+#endif
@@ -3,15 +3,21 @@
 
 enum { PLAY, STOP, BYPASS };
 
+const int kScopeBlockSize = 1024; // samples moved from the analysis tap per scope update
+const int kFastRefreshMs = 50;    // editor refresh while anything is changing or a scope is showing
+const int kSlowRefreshMs = 250;   // ...and once everything has been still for kIdleTicks
+const int kIdleTicks = 20;
+
 //==============================================================================
 PluginAudioProcessorEditor::PluginAudioProcessorEditor (PluginAudioProcessor* ownerFilter)
     : AudioProcessorEditor (ownerFilter),
-      scope_mode(SCOPE_VISIBLE|SCOPE_SONOGRAM), oscilloscope(NULL), spectrum(NULL), sonogram(NULL), scopeThread("Scope Thread"),
-      tabScope(TabbedButtonBar::TabsAtTop), infoLabel (String::empty)
+      scope_mode(SCOPE_VISIBLE|SCOPE_SONOGRAM), oscilloscope(NULL), spectrum(NULL), sonogram(NULL), history(NULL), scopeThread("Scope Thread"), scopeBlock(kScopeBlockSize * kNumAnalysisChannels),
+      tabScope(TabbedButtonBar::TabsAtTop), infoLabel (String::empty), idleTicks(0)
 {    
     // add controls..
     for(int c=0; c<kNumberOfControls; c++){
         const Control& control = UI_CONTROLS[c];
+        controlVersions[c] = -1; // forces the first refresh
         
         switch(control.type){
         case ROTARY:
@@ -110,21 +116,22 @@ PluginAudioProcessorEditor::PluginAudioProcessorEditor (PluginAudioProcessor* ow
         btnPlayback[b].setButtonText(szButtons[b]);
     }
     
-    // add an oscilloscope..
-    oscilloscope = new AudioOscilloscope();
-    oscilloscope->setHorizontalZoom(0.001);
-    oscilloscope->setTraceColour(Colours::white);
+    // add an oscilloscope (it draws the trace itself, so its FFT is left small)..
+    oscilloscope = new AnalysisScope(AnalysisScope::OSCILLOSCOPE, 6);
     
-    spectrum = new Spectroscope(10);
+    spectrum = new AnalysisScope(AnalysisScope::SPECTRUM, 10);
     spectrum->setLogFrequencyDisplay(true);
     
-    sonogram = new Sonogram(10);
+    sonogram = new AnalysisScope(AnalysisScope::SONOGRAM, 10);
     sonogram->setLogFrequencyDisplay(true);
     
+    history = new GainHistoryView();
+    
     addAndMakeVisible(&tabScope);
     tabScope.addTab("Oscilloscope", Colours::whitesmoke, oscilloscope, false, 0);
     tabScope.addTab("Spectrum", Colours::whitesmoke, spectrum, false, 1);
     tabScope.addTab("Sonogram", Colours::whitesmoke, sonogram, false, 2);
+    tabScope.addTab("GR History", Colours::whitesmoke, history, false, 3);
     tabScope.setTabBarDepth(24);
     tabScope.setIndent(4);
 
@@ -136,16 +143,27 @@ PluginAudioProcessorEditor::PluginAudioProcessorEditor (PluginAudioProcessor* ow
     setSize (  ownerFilter->lastUIWidth,
                ownerFilter->lastUIHeight);
 
-    startTimer (50);
+    // the scope FFTs and drawing run here, off the message thread
+    scopeThread.addTimeSliceClient(this);
+    scopeThread.startThread(3);
+    
+    // gain history is collected for as long as the editor is open, whichever tab is showing
+    ownerFilter->gainHistory.setActive(true);
+
+    startTimer (kFastRefreshMs);
 }
 
 PluginAudioProcessorEditor::~PluginAudioProcessorEditor()
 {
     scope_mode = SCOPE_HIDDEN;
+    getProcessor()->analysisTap.setActive(false);
+    getProcessor()->gainHistory.setActive(false);
+    
+    scopeThread.removeTimeSliceClient(this);
+    scopeThread.stopThread(1000);
     
     removeChildComponent(&tabScope);
 
-    scopeThread.stopThread(1000);
     stopTimer();
     
     for(int c=0; c<kNumberOfControls; c++){
@@ -161,6 +179,9 @@ PluginAudioProcessorEditor::~PluginAudioProcessorEditor()
     
     delete oscilloscope;
     oscilloscope = NULL;
+    
+    delete history;
+    history = NULL;
 }
 
 void PluginAudioProcessorEditor::setPlaybackState(bool playing){
@@ -170,6 +191,8 @@ void PluginAudioProcessorEditor::setPlaybackState(bool playing){
 
 void PluginAudioProcessorEditor::userTriedToCloseWindow(){
     scope_mode = SCOPE_HIDDEN;
+    getProcessor()->analysisTap.setActive(false);
+    getProcessor()->gainHistory.setActive(false);
 }
 
 //==============================================================================
@@ -220,7 +243,7 @@ void PluginAudioProcessorEditor::resized()
     
     resizer->setBounds (getWidth() - 16, getHeight() - 16, 16, 16);
     
-    scope_mode = (scope_mode & ~SCOPE_VISIBLE) | (getWidth() > 400 ? SCOPE_VISIBLE : SCOPE_HIDDEN);
+    scope_mode = (scope_mode.get() & ~SCOPE_VISIBLE) | (getWidth() > 400 ? SCOPE_VISIBLE : SCOPE_HIDDEN);
     
     getProcessor()->lastUIWidth = getWidth();
     getProcessor()->lastUIHeight = getHeight();
@@ -237,12 +260,22 @@ void PluginAudioProcessorEditor::timerCallback()
     if (lastDisplayedPosition != newPos)
         displayPositionInfo (newPos);
 
+    // only touch controls whose parameter has changed since they were last updated
+    bool bChanged = false;
     for(int c=0; c<kNumberOfControls && controls[c]; c++){
+        const int version = ourProcessor->getParameterVersion(c);
+        if (version == controlVersions[c])
+            continue;
+        controlVersions[c] = version;
+        bChanged = true;
+        
         switch (UI_CONTROLS[c].type){
         case ROTARY:
         case SLIDER:
+            ((Slider*)controls[c])->setValue (ourProcessor->getParameter(c), dontSendNotification);
+            break;
         case METER:
-            ((Slider*)controls[c])->setValue (ourProcessor->getParameter(c), dontSendNotification);
+            ((Meter*)controls[c])->setLevel (ourProcessor->getParameter(c));
             break;
         case MENU:
             ((ComboBox*)controls[c])->setSelectedId(ourProcessor->getParameter(c)+1, dontSendNotification);
@@ -255,19 +288,71 @@ void PluginAudioProcessorEditor::timerCallback()
         }
     }
     
-    if (scope_mode & SCOPE_VISIBLE) {
-        scope_mode = SCOPE_VISIBLE | (2 << tabScope.getCurrentTabIndex());
+    // drop to a slow refresh when nothing is moving and no scope needs feeding
+    if (bChanged || (scope_mode.get() & SCOPE_VISIBLE)){
+        idleTicks = 0;
+        if (getTimerInterval() != kFastRefreshMs)
+            startTimer (kFastRefreshMs);
+    }
+    else if (++idleTicks == kIdleTicks){
+        startTimer (kSlowRefreshMs);
+    }
+    
+    AnalysisTap& tap = ourProcessor->analysisTap;
+    const int mode = scope_mode.get();
+    tap.setActive((mode & SCOPE_VISIBLE) && !(mode & SCOPE_HISTORY));
+    
+    history->setSampleRate(ourProcessor->getSampleRate());
+    history->update(ourProcessor->gainHistory);
+    
+    if (mode & SCOPE_VISIBLE) {
+        const int visibleMode = SCOPE_VISIBLE | (2 << tabScope.getCurrentTabIndex());
+        scope_mode = visibleMode;
+        
+        spectrum->setSampleRate(ourProcessor->getSampleRate());
+        sonogram->setSampleRate(ourProcessor->getSampleRate());
         
-        if(spectrum && (scope_mode & SCOPE_SPECTRUM)){
-            spectrum->process();
+        if(oscilloscope && (visibleMode & SCOPE_OSCILLOSCOPE)){
+            oscilloscope->timerCallback();
+        }else if(spectrum && (visibleMode & SCOPE_SPECTRUM)){
             spectrum->timerCallback();
-        }else if(sonogram && (scope_mode & SCOPE_SONOGRAM)){
-            sonogram->process();
+        }else if(sonogram && (visibleMode & SCOPE_SONOGRAM)){
             sonogram->timerCallback();
         }
     }
 }
 
+// Runs on the scope thread: moves everything the audio thread has captured into the visible scope.
+int PluginAudioProcessorEditor::useTimeSlice()
+{
+    const int mode = scope_mode.get();
+    if (!(mode & SCOPE_VISIBLE))
+        return 50;
+    
+    PluginAudioProcessor* ourProcessor = getProcessor();
+    
+    if(mode & SCOPE_SPECTRUM){
+        BandActivity bands[8];
+        spectrum->setBandActivity(bands, ourProcessor->getBandActivity(bands, 8));
+    }
+    
+    float* pfChannels[kNumAnalysisChannels];
+    for(int c=0; c<kNumAnalysisChannels; c++)
+        pfChannels[c] = scopeBlock + c * kScopeBlockSize;
+    
+    int numRead;
+    while ((numRead = ourProcessor->analysisTap.read(pfChannels, kScopeBlockSize)) > 0){
+        if(mode & SCOPE_OSCILLOSCOPE)
+            oscilloscope->processSamples(pfChannels, numRead);
+        else if(mode & SCOPE_SPECTRUM)
+            spectrum->processSamples(pfChannels, numRead);
+        else if(mode & SCOPE_SONOGRAM)
+            sonogram->processSamples(pfChannels, numRead);
+    }
+    
+    return 20;
+}
+
 // This is our Slider::Listener callback, when the user drags a slider.
 void PluginAudioProcessorEditor::sliderValueChanged (Slider* slider)
 {
@@ -13,7 +13,8 @@ enum UI_MODE
     SCOPE_VISIBLE = 1,
     SCOPE_OSCILLOSCOPE = 2,
     SCOPE_SPECTRUM = 4,
-    SCOPE_SONOGRAM = 8
+    SCOPE_SONOGRAM = 8,
+    SCOPE_HISTORY = 16
 };
 
 class Meter : public Slider
@@ -23,6 +24,14 @@ public:
     {
         return "";
     }
+    
+    // only repaint once the level has moved by at least a pixel (or dropped to the bottom)
+    void setLevel (double newValue)
+    {
+        const double change = fabs(newValue - getValue()) * jmax(getWidth(), getHeight());
+        if (change >= getMaximum() - getMinimum() || (newValue == getMinimum() && change > 0.0))
+            setValue (newValue, dontSendNotification);
+    }
 };
 
 //==============================================================================
@@ -32,6 +41,7 @@ class PluginAudioProcessorEditor  : public AudioProcessorEditor,
                                             public SliderListener,
                                             public ButtonListener,
                                             public ComboBoxListener,
+                                            public TimeSliceClient,
                                             public Timer
 {
     friend class PluginAudioProcessor;
@@ -41,6 +51,7 @@ public:
 
     //==============================================================================
     void timerCallback();
+    int useTimeSlice();
     void paint (Graphics& g);
     void resized();
     
@@ -54,11 +65,13 @@ public:
     void setPlaybackState(bool playing);
 
 private:
-    int scope_mode;
-    AudioOscilloscope *oscilloscope;
-    Spectroscope *spectrum;
-    Sonogram *sonogram;
+    Atomic<int> scope_mode;                     // written on the message thread, read by the scope thread
+    AnalysisScope *oscilloscope;
+    AnalysisScope *spectrum;
+    AnalysisScope *sonogram;
+    GainHistoryView *history;
     TimeSliceThread scopeThread;
+    HeapBlock<float> scopeBlock;
     
     TabbedComponent tabScope;
     
@@ -70,6 +83,8 @@ private:
     
     Label label[kNumberOfControls];
     Component* controls[kNumberOfControls];
+    int controlVersions[kNumberOfControls];     // parameter version each control last showed
+    int idleTicks;
     
     ScopedPointer<ResizableCornerComponent> resizer;
     ComponentBoundsConstrainer resizeLimits;
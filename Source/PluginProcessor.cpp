@@ -6,7 +6,9 @@ Effect* JUCE_CALLTYPE createEffect(); // callback to create the plugin instance
 
 //==============================================================================
 PluginAudioProcessor::PluginAudioProcessor()
-: pEditor(NULL)
+: analysisTap(kNumAnalysisChannels), pEditor(NULL), readAheadThread("Test sound read-ahead"), readAheadSamples(32768),
+  inputBuffer(JucePlugin_MaxNumInputChannels, 4096),
+  analysisBuffer(kNumAnalysisChannels, 4096), analysisDelay(1, 1), analysisDelayPos(0)
 {
     program = 0;
     
@@ -16,17 +18,24 @@ PluginAudioProcessor::PluginAudioProcessor()
     lastPosInfo.resetToDefault();
 
     effect = createEffect();
+    effect->setGainHistory(&gainHistory);
     
     APDI::SAMPLE_RATE = 44100;
+    loadPrograms();
     
     formatManager.registerBasicFormats();
     transportSource.addChangeListener (this);
+    readAheadThread.startThread(3);
     
     loadResource("acousticguitar.aif");
 }
 
 PluginAudioProcessor::~PluginAudioProcessor()
 {
+    cancelPendingUpdate();
+    transportSource.setSource(nullptr);             // drops the buffering source before its thread goes
+    readAheadThread.stopThread(2000);
+    
     delete effect;
     effect = NULL;
 }
@@ -35,6 +44,12 @@ void PluginAudioProcessor::changeListenerCallback (ChangeBroadcaster* source)
 {
     if (source == &transportSource)
         (reinterpret_cast<PluginAudioProcessorEditor*>(pEditor))->setPlaybackState(transportSource.isPlaying());
+}
+
+// the effect's latency changed during processBlock - tell the host from here rather than the audio thread
+void PluginAudioProcessor::handleAsyncUpdate()
+{
+    setLatencySamples(effectLatency.get());
 }
 
 //==============================================================================
@@ -78,7 +93,17 @@ void PluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
     keyboardState.reset();
     
     transportSource.prepareToPlay (samplesPerBlock, sampleRate);
+    inputBuffer.setSize(jmax(getNumInputChannels(), getNumOutputChannels(), (int) JucePlugin_MaxNumInputChannels), samplesPerBlock);
+    analysisBuffer.setSize(kNumAnalysisChannels, jmax(samplesPerBlock, 256));
+    analysisDelay.setSize(1, juce::nextPowerOfTwo(roundToInt(sampleRate)));   // a second - longer than any lookahead
+    analysisDelay.clear();
+    analysisDelayPos = 0;
     stk::Stk::setSampleRate(sampleRate);
+    effect->prepare(sampleRate);
+    cachePrograms();                                // the crossover coefficients depend on the rate
+    
+    effectLatency = effect->getLatencySamples();
+    setLatencySamples(effectLatency.get());
 }
 
 void PluginAudioProcessor::releaseResources()
@@ -105,9 +130,12 @@ void PluginAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
     
     APDI::SAMPLE_RATE = this->getSampleRate();
     
-    static AudioSampleBuffer input(buffer.getNumChannels(), buffer.getNumSamples());
-    input = buffer;
-    
+    // a copy of the input, so the effect can filter the sidechain key in place
+    if (inputBuffer.getNumChannels() < buffer.getNumChannels() || inputBuffer.getNumSamples() < numSamples)
+        inputBuffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);   // only if the host breaks what prepareToPlay was told
+    AudioSampleBuffer& input = inputBuffer;
+    for (int i = 0; i < buffer.getNumChannels(); ++i)
+        input.copyFrom(i, 0, buffer, i, 0, numSamples);
 
     // In case we have more outputs than inputs, we'll clear any output
     // channels that didn't contain input data, (because these aren't
@@ -118,35 +146,32 @@ void PluginAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
     // get internal file playback (test sounds)
     AudioSourceChannelInfo channel(&buffer, 0, numSamples);
     transportSource.getNextAudioBlock (channel);
-    input.addFrom(0, 0, buffer.getSampleData(0), numSamples);
-    input.addFrom(1, 0, buffer.getSampleData(1), numSamples);
+    for (int i = 0; i < getNumOutputChannels(); ++i)
+        input.addFrom(i, 0, buffer.getSampleData(i), numSamples);
     
     // and now get the effect to process the input audio and generate its output.
     if(!isBypassed){
         buffer.clear();
+        effect->setNonRealtime(isNonRealtime());
+        effect->setNumChannels(getNumOutputChannels());
+        const int numSidechain = getNumInputChannels() - getNumOutputChannels();
+        effect->setSidechain(numSidechain > 0 ? input.getArrayOfChannels() + getNumOutputChannels() : NULL, numSidechain);
         effect->process(input.getArrayOfChannels(), buffer.getArrayOfChannels(), numSamples);
+        
+        const int latency = effect->getLatencySamples();
+        if (latency != effectLatency.get()){
+            effectLatency = latency;
+            triggerAsyncUpdate();
+        }
     }
     
-    if (getActiveEditor()){
-        PluginAudioProcessorEditor* editor = dynamic_cast<PluginAudioProcessorEditor*>(pEditor);
-        
-        AudioSampleBuffer& mono = input;
-        mono = buffer;
-        mono.addFrom(0, 0, input.getSampleData(1), numSamples);
-        mono.applyGain(0.5);
-
-        if(editor && editor->scope_mode & SCOPE_VISIBLE){
-            if(editor->oscilloscope && (editor->scope_mode & SCOPE_OSCILLOSCOPE))
-                editor->oscilloscope->processBlock(mono.getSampleData(0), numSamples);
-            else if(editor->spectrum && (editor->scope_mode & SCOPE_SPECTRUM))
-                editor->spectrum->copySamples(mono.getSampleData(0), numSamples);
-            else if(editor->sonogram)
-                editor->sonogram->copySamples(mono.getSampleData(0), numSamples);
-        }
-    }
+    // feed the scopes mono mixes of the output and input - the editor drains the tap on its scope thread
+    if (analysisTap.isActive())
+        writeAnalysis(input, buffer, isBypassed ? 0 : effect->getLatencySamples(), numSamples);
     
     // ask the host for the current time so we can display it...
     AudioPlayHead::CurrentPositionInfo newTime;
+    const bool wasPlaying = lastPosInfo.isPlaying;
 
     if (getPlayHead() != nullptr && getPlayHead()->getCurrentPosition (newTime))
     {
@@ -158,6 +183,47 @@ void PluginAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
         // If the host fails to fill-in the current time, we'll just clear it to a default..
         lastPosInfo.resetToDefault();
     }
+    
+    if (lastPosInfo.isPlaying && ! wasPlaying)
+        effect->transportStarted();
+}
+
+// mono mix of the main channels, for the scopes
+void PluginAudioProcessor::mixForAnalysis (AudioSampleBuffer& source, int startSample, float* pfMix, int numSamples)
+{
+    const int numChannels = getNumOutputChannels();
+    const float fScale = 1.0f / numChannels;
+    
+    FloatVectorOperations::copyWithMultiply(pfMix, source.getSampleData(0, startSample), fScale, numSamples);
+    for (int i = 1; i < numChannels; ++i)
+        FloatVectorOperations::addWithMultiply(pfMix, source.getSampleData(i, startSample), fScale, numSamples);
+}
+
+// writes the mixes to the tap a scratch buffer at a time, delaying the input by the
+// effect's latency so it lines up with the output it became
+void PluginAudioProcessor::writeAnalysis (AudioSampleBuffer& source, AudioSampleBuffer& output, int latency, int numSamples)
+{
+    const int chunkSize = analysisBuffer.getNumSamples();
+    const int mask = analysisDelay.getNumSamples() - 1;
+    latency = jmin(latency, mask);
+    
+    float* pfDelay = analysisDelay.getSampleData(0);
+    float* pfInput = analysisBuffer.getSampleData(ANALYSIS_INPUT);
+    float* pfOutput = analysisBuffer.getSampleData(ANALYSIS_OUTPUT);
+    
+    for (int start = 0; start < numSamples; start += chunkSize){
+        const int num = jmin(chunkSize, numSamples - start);
+        mixForAnalysis(source, start, pfInput, num);
+        mixForAnalysis(output, start, pfOutput, num);
+        
+        for (int n = 0; n < num; ++n){
+            pfDelay[analysisDelayPos] = pfInput[n];
+            pfInput[n] = pfDelay[(analysisDelayPos - latency) & mask];
+            analysisDelayPos = (analysisDelayPos + 1) & mask;
+        }
+        
+        analysisTap.write(analysisBuffer.getArrayOfChannels(), num);
+    }
 }
 
 void PluginAudioProcessor::loadResource(const char* filename){
@@ -168,12 +234,35 @@ void PluginAudioProcessor::loadResource(const char* filename){
     CFRelease(resourcesURL);
     
     File file(std::string(path) + "/" + filename);
-    auto* reader = formatManager.createReaderFor (file);
+    
+    const int64 kPreloadBytes = 16 * 1024 * 1024;   // about 90s of 16-bit stereo at 44.1kHz
+    
+    // PCM wav and aiff files are memory-mapped, so samples are converted straight out of the
+    // mapping with no buffered read() in between. Other short files are read into memory once,
+    // so looping them never touches the disk again. Either way, reading and decoding happen on
+    // readAheadThread rather than the audio thread.
+    AudioFormatReader* reader = nullptr;
+    if (AudioFormat* format = formatManager.findFormatForFileExtension (file.getFileExtension()))
+    {
+        ScopedPointer<MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+        if (mapped != nullptr && mapped->mapEntireFile())
+            reader = mapped.release();
+    }
+    
+    if (reader == nullptr)
+    {
+        MemoryBlock data;
+        if (file.getSize() <= kPreloadBytes && file.loadFileAsData (data))
+            reader = formatManager.createReaderFor (new MemoryInputStream (data, true));
+        else
+            reader = formatManager.createReaderFor (file);
+    }
+    
     if (reader != nullptr)
     {
         std::unique_ptr<AudioFormatReaderSource> newSource (new AudioFormatReaderSource (reader, true)); // [11]
         newSource->setLooping(true);
-        transportSource.setSource (newSource.get(), 0, nullptr, reader->sampleRate);                     // [12]
+        transportSource.setSource (newSource.get(), readAheadSamples, &readAheadThread, reader->sampleRate); // [12]
         readerSource.reset (newSource.release());                                                        // [14]
     }
 }
@@ -185,37 +274,243 @@ AudioProcessorEditor* PluginAudioProcessor::createEditor()
 }
 
 //==============================================================================
-void PluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+// State is saved as a small binary chunk:
+//   header - magic, schema version, header size, parameter count, UI width and height
+//   body   - one (parameter id, value) pair per parameter
+//   curves - (version 2 on) the effect's transfer curves: a count, then per curve a point
+//            count and (input, output, knee) for each point
+// Parameter ids are the kParam numbers in UI_CONTROLS, which never change meaning, so
+// chunks saved by older or newer builds still load; unknown ids are skipped. Chunks from
+// before this format are XML, and are still read (see setLegacyState).
+
+namespace
 {
-    // You should use this method to store your parameters in the memory block.
-    // Here's an example of how you can use XML to make it easy and more robust:
-
-    // Create an outer XML element..
-    XmlElement xml ("MYPLUGINSETTINGS");
-
-    // add some attributes to it..
-    xml.setAttribute ("uiWidth", lastUIWidth);
-    xml.setAttribute ("uiHeight", lastUIHeight);
+    const int kStateMagic = 0x73434244;                     // "DBCs"
+    const int kStateVersion = 2;
+    const int kStateHeaderSize = 4 + 2 + 2 + 2 + 4 + 4;
+    const int kStateRecordSize = 2 + 4;
+    const int kMaxStateCurves = 8;
     
-    for(int p=0; p<getNumParameters(); p++){
-        String name;
-        for (String::CharPointerType t (UI_CONTROLS[p].name.getCharPointer()); ! t.isEmpty(); ++t){
-            if(t.isLetterOrDigit() || *t == '_' || *t == '-' || *t == ':'){
-                name += *t;
+    // attribute names used by the XML format
+    StringArray makeLegacyKeys()
+    {
+        StringArray keys;
+        for(int p=0; p<kNumberOfParameters; p++){
+            String name;
+            for (String::CharPointerType t (UI_CONTROLS[p].name.getCharPointer()); ! t.isEmpty(); ++t){
+                if(t.isLetterOrDigit() || *t == '_' || *t == '-' || *t == ':'){
+                    name += *t;
+                }
             }
+            keys.add(name);
         }
-        xml.setAttribute(name, getParameter(p));
+        return keys;
     }
+    
+    // worked out once rather than on every load
+    const StringArray& getLegacyKeys()
+    {
+        static const StringArray keys (makeLegacyKeys());
+        return keys;
+    }
+    
+    // Reads a chunk into values[] (indexed by parameter id), leaving any parameter it doesn't
+    // hold as it was, and any curves into curves[] if given. Returns false if the data isn't
+    // in this format.
+    bool readStateChunk (const void* data, int sizeInBytes, float* values, int& uiWidth, int& uiHeight,
+                         TransferCurve* curves = nullptr, int maxCurves = 0, int* numCurves = nullptr)
+    {
+        MemoryInputStream stream (data, sizeInBytes, false);
+        
+        if (sizeInBytes < kStateHeaderSize || stream.readInt() != kStateMagic)
+            return false;
+        
+        const int version = stream.readShort();
+        const int headerSize = (unsigned short) stream.readShort();
+        const int numParameters = (unsigned short) stream.readShort();
+        const int width = stream.readInt();
+        const int height = stream.readInt();
+        
+        if (headerSize < kStateHeaderSize || headerSize > sizeInBytes)
+            return false;                                           // damaged - the header can't be shorter than ours or run off the end
+        
+        uiWidth = width;
+        uiHeight = height;
+        stream.setPosition (headerSize);                            // skip any header fields added since
+        
+        for(int i=0; i<numParameters && stream.getNumBytesRemaining() >= kStateRecordSize; i++){
+            const int id = (unsigned short) stream.readShort();
+            const float value = stream.readFloat();
+            if (id < kNumberOfParameters)
+                values[id] = value;
+        }
+        
+        if (version >= 2 && curves != nullptr && stream.getNumBytesRemaining() >= 2){
+            const int count = (unsigned short) stream.readShort();
+            for(int c=0; c<count && stream.getNumBytesRemaining() >= 2; c++){
+                TransferCurve curve;
+                const int numPoints = (unsigned short) stream.readShort();
+                for(int k=0; k<numPoints && stream.getNumBytesRemaining() >= 12; k++){
+                    const float input = stream.readFloat();
+                    const float output = stream.readFloat();
+                    const float knee = stream.readFloat();
+                    if (k < TransferCurve::kMaxPoints){
+                        curve.fInput[k] = input;
+                        curve.fOutput[k] = output;
+                        curve.fKnee[k] = knee;
+                        curve.iNumPoints = k + 1;
+                    }
+                }
+                if (c < maxCurves)
+                    curves[c] = curve;
+            }
+            if (numCurves != nullptr)
+                *numCurves = jmin(count, maxCurves);
+        }
+        return true;
+    }
+    
+    // Writes a chunk in the current format - values[] indexed by parameter id
+    void writeStateChunk (OutputStream& stream, const float* values, int uiWidth, int uiHeight,
+                          const TransferCurve* curves, int numCurves)
+    {
+        stream.writeInt (kStateMagic);
+        stream.writeShort ((short) kStateVersion);
+        stream.writeShort ((short) kStateHeaderSize);
+        stream.writeShort ((short) kNumberOfParameters);
+        stream.writeInt (uiWidth);
+        stream.writeInt (uiHeight);
+        
+        for(int p=0; p<kNumberOfParameters; p++){
+            stream.writeShort ((short) UI_CONTROLS[p].parameter);
+            stream.writeFloat (values[UI_CONTROLS[p].parameter]);
+        }
+        
+        stream.writeShort ((short) numCurves);
+        for(int c=0; c<numCurves; c++){
+            stream.writeShort ((short) curves[c].iNumPoints);
+            for(int k=0; k<curves[c].iNumPoints; k++){
+                stream.writeFloat (curves[c].fInput[k]);
+                stream.writeFloat (curves[c].fOutput[k]);
+                stream.writeFloat (curves[c].fKnee[k]);
+            }
+        }
+    }
+    
+   #if JUCE_DEBUG
+    // Writes a chunk with curves and reads it back, whole and cut short - checked the first
+    // time a debug build saves its state
+    bool stateChunkRoundTrips()
+    {
+        float values[kNumberOfParameters], readValues[kNumberOfParameters];
+        for(int p=0; p<kNumberOfParameters; p++){
+            values[p] = p * 0.25f - 3.0f;
+            readValues[p] = 0.0f;
+        }
+        
+        TransferCurve curves[2];
+        curves[0].iNumPoints = 3;
+        curves[1].iNumPoints = TransferCurve::kMaxPoints;
+        for(int c=0; c<2; c++){
+            for(int k=0; k<curves[c].iNumPoints; k++){
+                curves[c].fInput[k] = -60.0f + 10.0f * k;
+                curves[c].fOutput[k] = -60.0f + (5.0f + c) * k;
+                curves[c].fKnee[k] = 0.5f * k;
+            }
+        }
+        
+        MemoryBlock block;
+        {
+            MemoryOutputStream stream (block, false);
+            writeStateChunk (stream, values, 640, 480, curves, 2);
+        }
+        
+        int width = 0, height = 0, numCurves = 0;
+        TransferCurve readCurves[kMaxStateCurves];
+        if (! readStateChunk (block.getData(), (int) block.getSize(), readValues, width, height, readCurves, kMaxStateCurves, &numCurves))
+            return false;
+        if (width != 640 || height != 480 || numCurves != 2)
+            return false;
+        for(int p=0; p<kNumberOfParameters; p++){
+            if (readValues[p] != values[p])
+                return false;
+        }
+        for(int c=0; c<2; c++){
+            if (readCurves[c].iNumPoints != curves[c].iNumPoints)
+                return false;
+            for(int k=0; k<curves[c].iNumPoints; k++){
+                if (readCurves[c].fInput[k] != curves[c].fInput[k] || readCurves[c].fOutput[k] != curves[c].fOutput[k]
+                    || readCurves[c].fKnee[k] != curves[c].fKnee[k])
+                    return false;
+            }
+        }
+        
+        // a chunk cut off inside the last curve still loads, with that curve's complete points
+        numCurves = 0;
+        readCurves[1] = TransferCurve();
+        if (! readStateChunk (block.getData(), (int) block.getSize() - 6, readValues, width, height, readCurves, kMaxStateCurves, &numCurves))
+            return false;
+        return numCurves == 2 && readCurves[1].iNumPoints == TransferCurve::kMaxPoints - 1;
+    }
+   #endif
+    
+    struct PresetFileSorter
+    {
+        static int compareElements (const File& first, const File& second)
+        {
+            return first.getFileName().compareIgnoreCase (second.getFileName());
+        }
+    };
+}
 
-    // then use this helper function to stuff it into the binary blob and return it..
-    copyXmlToBinary (xml, destData);
+void PluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+   #if JUCE_DEBUG
+    static const bool formatRoundTrips = stateChunkRoundTrips();
+    jassert (formatRoundTrips);
+   #endif
+    
+    float values[kNumberOfParameters];
+    for(int p=0; p<kNumberOfParameters; p++){
+        values[p] = getParameter(p);
+    }
+    
+    const int numCurves = jmin(effect->getNumTransferCurves(), (int) kMaxStateCurves);
+    TransferCurve curves[kMaxStateCurves];
+    for(int c=0; c<numCurves; c++){
+        effect->getTransferCurve(c, curves[c]);
+    }
+    
+    MemoryOutputStream stream (destData, false);
+    writeStateChunk (stream, values, lastUIWidth, lastUIHeight, curves, numCurves);
 }
 
 void PluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    float values[kNumberOfParameters];
+    for(int p=0; p<kNumberOfParameters; p++){
+        values[p] = getParameter(p);
+    }
+    
+    const int maxCurves = jmin(effect->getNumTransferCurves(), (int) kMaxStateCurves);
+    TransferCurve curves[kMaxStateCurves];
+    int numCurves = 0;
+    
+    if (! readStateChunk(data, sizeInBytes, values, lastUIWidth, lastUIHeight, curves, maxCurves, &numCurves)){
+        setLegacyState(data, sizeInBytes);
+        return;
+    }
+    
+    for(int p=0; p<kNumberOfParameters; p++){
+        setParameter(p, values[p]);
+    }
+    for(int c=0; c<numCurves; c++){
+        effect->setTransferCurve(c, curves[c]);
+    }
+}
 
+void PluginAudioProcessor::setLegacyState (const void* data, int sizeInBytes)
+{
     // This getXmlFromBinary() helper function retrieves our XML from the binary blob..
     ScopedPointer<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
@@ -228,21 +523,20 @@ void PluginAudioProcessor::setStateInformation (const void* data, int sizeInByte
             lastUIWidth  = xmlState->getIntAttribute ("uiWidth", lastUIWidth);
             lastUIHeight = xmlState->getIntAttribute ("uiHeight", lastUIHeight);
 
+            // controls that share a name also shared an attribute, so they all load the
+            // value that was saved last - kept as it was, so old sessions sound the same
+            const StringArray& keys = getLegacyKeys();
             for(int p=0; p<getNumParameters(); p++){
-                String name;
-                for (String::CharPointerType t (UI_CONTROLS[p].name.getCharPointer()); ! t.isEmpty(); ++t){
-                    if(t.isLetterOrDigit() || *t == '_' || *t == '-' || *t == ':'){
-                        name += *t;
-                    }
-                }
-                setParameter(p, (float) xmlState->getDoubleAttribute (name, getParameter(p)));
+                setParameter(p, (float) xmlState->getDoubleAttribute (keys[p], getParameter(p)));
             }
         }
     }
 }
 
-const String PluginAudioProcessor::getInputChannelName (const int channelIndex) const
-{
+const String PluginAudioProcessor::getInputChannelName (const int channelIndex) const
+{
+    if (channelIndex >= getNumOutputChannels())
+        return "Sidechain " + String (channelIndex - getNumOutputChannels() + 1);
     return String (channelIndex + 1);
 }
 
@@ -289,20 +583,75 @@ double PluginAudioProcessor::getTailLengthSeconds() const
     return 0.0;
 }
 
+//==============================================================================
+// Programs are the factory presets followed by any user presets, which are state chunks
+// (as getStateInformation writes them) found as <name>.preset in getUserPresetFolder().
+// The effect caches whatever it derives from each program's values, so switching
+// program on the audio thread costs nothing but a crossfade.
+
+File PluginAudioProcessor::getUserPresetFolder()
+{
+    return File::getSpecialLocation (File::userApplicationDataDirectory)
+            .getChildFile (JucePlugin_Manufacturer).getChildFile (JucePlugin_Name).getChildFile ("Presets");
+}
+
+void PluginAudioProcessor::loadPrograms()
+{
+    programs.clear();
+    for(int i=0; i<(int)(sizeof(UI_PRESETS) / sizeof(Preset)); i++){
+        programs.add (new Preset (UI_PRESETS[i]));
+    }
+    
+    Array<File> files;
+    getUserPresetFolder().findChildFiles (files, File::findFiles, false, "*.preset");
+    PresetFileSorter sorter;
+    files.sort (sorter);
+    
+    for(int i=0; i<files.size(); i++){
+        MemoryBlock data;
+        if (! files.getReference(i).loadFileAsData (data))
+            continue;
+        
+        ScopedPointer<Preset> preset (new Preset());
+        for(int p=0; p<kNumberOfParameters; p++){
+            preset->value[p] = UI_CONTROLS[p].initial;             // anything the file doesn't hold
+        }
+        
+        int width, height;
+        if (readStateChunk (data.getData(), (int) data.getSize(), preset->value, width, height)){
+            preset->name = files.getReference(i).getFileNameWithoutExtension();
+            programs.add (preset.release());
+        }
+    }
+    
+    cachePrograms();
+}
+
+void PluginAudioProcessor::cachePrograms()
+{
+    for(int i=0; i<programs.size(); i++){
+        effect->cachePreset(i, programs[i]->value);
+    }
+}
+
 int PluginAudioProcessor::getNumPrograms()                                                {
-    return sizeof(UI_PRESETS) / sizeof(Preset);
+    return programs.size();
 }
 int PluginAudioProcessor::getCurrentProgram(){
     return program;
 }
 void PluginAudioProcessor::setCurrentProgram (int index){
+    if (! isPositiveAndBelow(index, programs.size()))
+        return;
+    
     program = index;
+    effect->selectPreset(index);                                // before the values, so the next block fades rather than jumps
     for(int p=0; p<kNumberOfParameters; p++){
-        setParameter(p, UI_PRESETS[index].value[p]);
+        setParameter(p, programs[index]->value[p]);
     }
 }
 const String PluginAudioProcessor::getProgramName (int index)                         {
-    return UI_PRESETS[index].name;
+    return isPositiveAndBelow(index, programs.size()) ? programs[index]->name : String::empty;
 }
 
 //==============================================================================
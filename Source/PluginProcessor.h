@@ -5,6 +5,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "modules/stk_module/stk.h"
+#include "PluginAnalysis.h"
 
 class IPluginParameters
 {
@@ -30,8 +31,10 @@ class PluginParameters : public IPluginParameters
 public:
     PluginParameters() {
         // Set up some default values..
-        for(int p=0; p<COUNT; p++)
+        for(int p=0; p<COUNT; p++){
             parameters[p] = 0.0f;
+            versions[p] = 0;
+        }
     }
     
     //==============================================================================
@@ -48,11 +51,36 @@ public:
     }
     
     void setParameter (int index, float newValue)
+    {
+        if(index >= 0 && index < COUNT && parameters[index] != newValue){
+            parameters[index] = newValue;
+            ++versions[index];
+        }
+    }
+    
+    // stores a value without bumping its version - for meters, which are written every
+    // sample and call touchParameter() at most once a block instead
+    void setParameterValue (int index, float newValue)
     {
         if(index >= 0 && index < COUNT)
             parameters[index] = newValue;
     }
     
+    void touchParameter (int index)
+    {
+        if(index >= 0 && index < COUNT)
+            ++versions[index];
+    }
+    
+    // bumped whenever a parameter's value changes, so the editor can skip unchanged controls
+    // (bumped on the audio thread and read on the message thread, hence atomic)
+    int getParameterVersion (int index) const
+    {
+        if(index >= 0 && index < COUNT)
+            return versions[index].get();
+        return 0;
+    }
+    
     const String getParameterName (int index) const
     {
         if(index >= 0 && index < COUNT)
@@ -66,11 +94,25 @@ public:
     }
 private:
     float parameters[COUNT];
+    Atomic<int> versions[COUNT];
+};
+
+// A user transfer curve: breakpoints from input to output level (dB), each with a knee
+// width over which the slopes either side of it are blended. Below the first breakpoint
+// the curve is 1:1; above the last it carries on along the last segment.
+struct TransferCurve
+{
+    enum { kMaxPoints = 8 };
+    
+    TransferCurve() : iNumPoints(0) {}
+    
+    int iNumPoints;
+    float fInput[kMaxPoints], fOutput[kMaxPoints], fKnee[kMaxPoints];
 };
 
 class Effect : public PluginParameters<kNumberOfParameters> {
 public:
-    Effect() {
+    Effect() : pfSidechain(NULL), iSidechainChannels(0), pGainHistory(NULL), iNumChannels(2), bNonRealtime(false) {
         APDI::SAMPLE_RATE = 44100.0; // sample rate potentially not valid before playback
         
         for(int p=0; p<kNumberOfParameters; p++)
@@ -86,15 +128,57 @@ public:
     
     virtual void process(float** inputBuffers, float** outputBuffers, int numSamples) {}
     
+    virtual int getLatencySamples() { return 0; } // delay added to the output, reported to the host
+    
+    // called from prepareToPlay while the audio is stopped - redesign anything tied to the sample rate
+    virtual void prepare(double sampleRate) {}
+    
+    // called on the audio thread between blocks when the host's transport starts
+    virtual void transportStarted() {}
+    
+    void setNonRealtime(bool offline) { bNonRealtime = offline; }
+    
+    // number of main channels in the buffers passed to process()
+    void setNumChannels(int numChannels) { iNumChannels = numChannels; }
+    bool isNonRealtime() const { return bNonRealtime; }
+    
+    // external key input (any input channels beyond the outputs) - scratch data, may be filtered in place
+    void setSidechain(float** sidechainBuffers, int numChannels) { pfSidechain = sidechainBuffers; iSidechainChannels = numChannels; }
+    
+    // per-band gain over the last block, for the editor's analysis overlay - returns the number of bands
+    virtual int getBandActivity(BandActivity* bands, int maxBands) { return 0; }
+    
+    // destination for per-hop gain statistics, written while the tap is active
+    void setGainHistory(GainHistoryTap* tap) { pGainHistory = tap; }
+    
+    // program bank - anything derived from a program's values is worked out when it is cached
+    // (message thread), so selecting it is a pointer swap the next block picks up
+    virtual void cachePreset(int iPresetNum, const float* pfValues) {}
+    virtual void selectPreset(int iPresetNum) {}
+    
+    // user transfer curves, one per band - set and read from the message thread, saved with the state
+    virtual int getNumTransferCurves() { return 0; }
+    virtual void setTransferCurve(int iBand, const TransferCurve& curve) {}
+    virtual void getTransferCurve(int iBand, TransferCurve& curve) {}
+    
 //    void setCurrentPlaybackSampleRate (const double newRate){
 //        Synthesiser::setCurrentPlaybackSampleRate(APDI::SAMPLE_RATE = newRate);
 //    }
+    
+protected:
+    float** pfSidechain;
+    int iSidechainChannels;
+    GainHistoryTap* pGainHistory;
+    int iNumChannels;
+    
+private:
+    bool bNonRealtime;
 };
 
 //==============================================================================
 /**
 */
-class PluginAudioProcessor  : public AudioProcessor, public ChangeListener //, public IPluginParameters
+class PluginAudioProcessor  : public AudioProcessor, public ChangeListener, public AsyncUpdater //, public IPluginParameters
 {
     friend class PluginAudioProcessorEditor;
 public:
@@ -130,6 +214,7 @@ public:
     void setParameter (int index, float newValue);
     const String getParameterName (int index);
     const String getParameterText (int index);
+    int getParameterVersion (int index) { return effect->getParameterVersion(index); }
 
     //==============================================================================
     int getNumPrograms();
@@ -137,13 +222,16 @@ public:
     void setCurrentProgram (int /*index*/);
     const String getProgramName (int /*index*/);
     void changeProgramName (int /*index*/, const String& /*newName*/){}
+    static File getUserPresetFolder();
     void setBypass(bool bypass = true){ isBypassed = bypass; }
 
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData);
     void setStateInformation (const void* data, int sizeInBytes);
+    void setLegacyState (const void* data, int sizeInBytes);
     
     void changeListenerCallback (ChangeBroadcaster* source) override;
+    void handleAsyncUpdate() override;
 
     // this is kept up to date with the midi messages that arrive, and the UI component
     // registers with it so it can represent the incoming messages
@@ -160,19 +248,38 @@ public:
     
     void onButtonClicked(int control) {}
     void loadResource(const char* filename);
+    void setReadAheadSize(int numSamples) { readAheadSamples = numSamples; }  // used from the next loadResource
     AudioTransportSource* getTransport() { return &transportSource; }
+    
+    // output and input samples for the editor's scopes (audio thread writes, scope thread reads)
+    AnalysisTap analysisTap;
+    GainHistoryTap gainHistory;
+    int getBandActivity(BandActivity* bands, int maxBands) { return effect->getBandActivity(bands, maxBands); }
 
 private:
     AudioProcessorEditor* pEditor;
     
     Effect* effect;
+    Atomic<int> effectLatency;          // latest latency from the audio thread, reported to the host from the message thread
     
     int program;
     bool isBypassed;
+    OwnedArray<Preset> programs;        // factory presets, then any user presets found on disk
+    
+    void loadPrograms();
+    void cachePrograms();
     
     AudioFormatManager formatManager;
+    TimeSliceThread readAheadThread;    // reads and decodes test sounds ahead of the audio thread
+    int readAheadSamples;
     std::unique_ptr<AudioFormatReaderSource> readerSource;
     AudioTransportSource transportSource;
+    AudioSampleBuffer inputBuffer;      // input and sidechain, copied each block - sized in prepareToPlay
+    AudioSampleBuffer analysisBuffer;   // mono mixes for the analysis tap, sized in prepareToPlay
+    AudioSampleBuffer analysisDelay;    // power-of-two ring lining the input mix up with the output
+    int analysisDelayPos;
+    void mixForAnalysis (AudioSampleBuffer& source, int startSample, float* pfMix, int numSamples);
+    void writeAnalysis (AudioSampleBuffer& source, AudioSampleBuffer& output, int latency, int numSamples);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginAudioProcessor)
 };